@@ -21,6 +21,192 @@ El Dorado Hills, CA, 95762
 */
 #include "coremark.h"
 
+//--------------------------------------------------------core_kprof.c---------------------------------------------------------//
+#if KERNEL_PROFILE
+/* Statistics of the context running on this thread, NULL outside of <iterate> */
+CORE_THREAD_LOCAL core_kprof *kprof_cur;
+
+static const char *kprof_names[NUM_KERNELS]={
+	"iterate","list find","list reverse","list sort","state","matrix",
+	"  add_const","  mul_const","  mul_vect","  mul_matrix","  mul_matrix_bitextract","  sum"
+};
+
+/* Function: kprof_begin
+	Clear the statistics of a context and make them current for this thread.
+*/
+void kprof_begin(core_results *res) {
+	memset(&(res->kprof),0,sizeof(core_kprof));
+	kprof_cur=&(res->kprof);
+}
+/* Function: kprof_add
+	Account the time since start to a kernel.
+*/
+void kprof_add(core_kernel_e id, CORE_TICKS start) {
+	CORE_TICKS stop=portable_timer->now();
+	if (kprof_cur) {
+		kprof_cur->ticks[id]+=stop-start;
+		kprof_cur->calls[id]++;
+	}
+}
+/* Function: kprof_end
+	Account the whole run of <iterate> to context res and detach its statistics from this thread.
+*/
+void kprof_end(core_results *res, CORE_TICKS start) {
+	res->kprof.ticks[KERNEL_ITERATE]+=portable_timer->now()-start;
+	res->kprof.calls[KERNEL_ITERATE]++;
+	kprof_cur=NULL;
+}
+/* Function: kprof_report
+	Report time, calls and share of the run per kernel, summed over all contexts.
+
+	The cost of the timer reads is estimated and taken out of every interval, including the
+	probes nested inside it. Since <calc_func> runs the state and matrix kernels from within
+	the list sort, list sort is reported exclusive of them. The matrix steps are shares of the matrix kernel.
+*/
+void kprof_report(core_results **res, ee_u32 num) {
+	core_kprof sum;
+	CORE_TICKS t0,read,nested;
+	ee_u32 i,k,probes=0,matrix_steps=0;
+	memset(&sum,0,sizeof(sum));
+	for (i=0; i<num; i++) {
+		for (k=0; k<NUM_KERNELS; k++) {
+			sum.ticks[k]+=res[i]->kprof.ticks[k];
+			sum.calls[k]+=res[i]->kprof.calls[k];
+		}
+	}
+	if (sum.ticks[KERNEL_ITERATE]==0)
+		return;
+	/* estimate the cost of one timer read */
+	t0=portable_timer->now();
+	for (i=0; i<1000; i++)
+		(void)portable_timer->now();
+	read=(portable_timer->now()-t0)/1000;
+	for (k=KERNEL_LIST_FIND; k<NUM_KERNELS; k++)
+		probes+=sum.calls[k];
+	for (k=KERNEL_MATRIX+1; k<NUM_KERNELS; k++)
+		matrix_steps+=sum.calls[k];
+	for (k=0; k<NUM_KERNELS; k++) {
+		nested=read*sum.calls[k];
+		if (k==KERNEL_ITERATE)
+			nested+=2*read*probes;
+		if (k==KERNEL_MATRIX)
+			nested+=2*read*matrix_steps;
+		if (k==KERNEL_LIST_SORT)
+			nested+=2*read*(sum.calls[KERNEL_STATE]+sum.calls[KERNEL_MATRIX]+matrix_steps);
+		sum.ticks[k]=(sum.ticks[k]>nested) ? sum.ticks[k]-nested : 0;
+	}
+	if (sum.ticks[KERNEL_LIST_SORT]>sum.ticks[KERNEL_STATE]+sum.ticks[KERNEL_MATRIX])
+		sum.ticks[KERNEL_LIST_SORT]-=sum.ticks[KERNEL_STATE]+sum.ticks[KERNEL_MATRIX];
+	else
+		sum.ticks[KERNEL_LIST_SORT]=0;
+	ee_printf("Kernel profile (%s timer)\n",portable_timer->name);
+	ee_printf("  %-24s %10s %12s %10s %7s\n","kernel","calls","total ms","ns/call","share");
+	for (k=0; k<NUM_KERNELS; k++) {
+		CORE_TICKS base=(k>KERNEL_MATRIX) ? sum.ticks[KERNEL_MATRIX] : sum.ticks[KERNEL_ITERATE];
+		double ms=time_in_secs(sum.ticks[k])*1000.0;
+		ee_printf("  %-24s %10u %12.3f %10.1f %6.1f%%\n",kprof_names[k],sum.calls[k],ms,
+			sum.calls[k] ? ms*1e6/sum.calls[k] : 0.0,base ? 100.0*sum.ticks[k]/base : 0.0);
+	}
+	ee_printf("  probe overhead ~%.1f ns per timer read, %u probes, %.2f%% of the measured run (removed above)\n",
+		time_in_secs(read)*1e9,probes,100.0*(double)(2*read*probes)/(double)(sum.ticks[KERNEL_ITERATE]+2*read*probes));
+}
+#endif
+//--------------------------------------------------------core_kprof.c---------------------------------------------------------//
+
+//--------------------------------------------------------core_latency.c-------------------------------------------------------//
+#if LATENCY_HIST
+/* Function: latency_bucket
+	Index of the histogram bucket holding v.
+*/
+static ee_u32 latency_bucket(CORE_TICKS v) {
+	ee_u32 e;
+	if (v<LAT_SUB)
+		return (ee_u32)v;
+	e=63-__builtin_clzll((unsigned long long)v);
+	return (e-LAT_SUB_BITS+1)*LAT_SUB+(ee_u32)((v>>(e-LAT_SUB_BITS))-LAT_SUB);
+}
+/* Function: latency_bucket_top
+	Highest value recorded in bucket b.
+*/
+static CORE_TICKS latency_bucket_top(ee_u32 b) {
+	ee_u32 g=b/LAT_SUB;
+	if (g==0)
+		return b;
+	return ((((CORE_TICKS)(b%LAT_SUB+LAT_SUB))+1)<<(g-1))-1;
+}
+/* Function: latency_begin
+	Clear a histogram.
+*/
+void latency_begin(core_latency *h) {
+	memset(h,0,sizeof(core_latency));
+}
+/* Function: latency_record
+	Record one latency of v ticks.
+*/
+void latency_record(core_latency *h, CORE_TICKS v) {
+	h->count[latency_bucket(v)]++;
+	h->total++;
+	if (v>h->max)
+		h->max=v;
+}
+/* Function: latency_percentile
+	Return the latency at quantile q (0<q<=1), as the top of the bucket holding it.
+	The result is exact to within 1/<LAT_SUB> and never above the recorded maximum.
+*/
+CORE_TICKS latency_percentile(core_latency *h, double q) {
+	ee_u32 b;
+	unsigned long long rank=(unsigned long long)(q*h->total+0.999999),seen=0;
+	if (rank==0)
+		rank=1;
+	for (b=0; b<LAT_BUCKETS; b++) {
+		seen+=h->count[b];
+		if (seen>=rank) {
+			CORE_TICKS top=latency_bucket_top(b);
+			return (top<h->max) ? top : h->max;
+		}
+	}
+	return h->max;
+}
+/* Function: latency_report
+	Report the per iteration latency percentiles of every context in microseconds.
+
+	The recording overhead is estimated by timing the timer read and the histogram update
+	on a scratch histogram, and reported as a share of the median iteration.
+*/
+void latency_report(core_results **res, ee_u32 num) {
+	static const double q[5]={0.5,0.9,0.99,0.999,1.0};
+	core_latency *scratch=(core_latency *)portable_malloc(sizeof(core_latency));
+	CORE_TICKS t0,prev,cost;
+	ee_u32 i,k;
+	double med=0;
+	ee_printf("Iteration latency (us, %s timer)\n",portable_timer->name);
+	ee_printf("  %-4s %10s %10s %10s %10s %10s %10s\n","ctx","count","p50","p90","p99","p99.9","max");
+	for (i=0; i<num; i++) {
+		core_latency *h=&(res[i]->lat);
+		if (h->total==0)
+			continue;
+		ee_printf("  %-4u %10u",i,h->total);
+		for (k=0; k<5; k++)
+			ee_printf(" %10.3f",time_in_secs(latency_percentile(h,q[k]))*1e6);
+		ee_printf("\n");
+		if (i==0)
+			med=time_in_secs(latency_percentile(h,0.5));
+	}
+	latency_begin(scratch);
+	t0=prev=portable_timer->now();
+	for (i=0; i<1000; i++) {
+		CORE_TICKS now=portable_timer->now();
+		latency_record(scratch,now-prev);
+		prev=now;
+	}
+	cost=(portable_timer->now()-t0)/1000;
+	portable_free(scratch);
+	ee_printf("  recording overhead ~%.1f ns per iteration (%.3f%% of the median iteration), included in the latencies above\n",
+		time_in_secs(cost)*1e9,(med>0) ? 100.0*time_in_secs(cost)/med : 0.0);
+}
+#endif
+//--------------------------------------------------------core_latency.c-------------------------------------------------------//
+
 //--------------------------------------------------------core_state.c---------------------------------------------------------//
 enum CORE_STATE core_state_transition( ee_u8 **instr , ee_u32 *transition_count);
 
@@ -297,6 +483,7 @@ list_head *core_list_mergesort(list_head *list, list_cmp cmp, core_results *res)
 ee_s16 calc_func(ee_s16 *pdata, core_results *res) {
 	ee_s16 data=*pdata;
 	ee_s16 retval;
+	KPROF_DECL(t);
 	ee_u8 optype=(data>>7) & 1; /* bit 7 indicates if the function result has been cached */
 	if (optype) /* if cached, use cache */
 		return (data & 0x007f);
@@ -308,20 +495,24 @@ ee_s16 calc_func(ee_s16 *pdata, core_results *res) {
 			case 0:
 				if (dtype<0x22) /* set min period for bit corruption */
 					dtype=0x22;
-				retval=core_bench_state(res->size,res->memblock[3],res->seed1,res->seed2,dtype,res->crc);
-				if (res->crcstate==0)
-					res->crcstate=retval;
+				KPROF_START(t);
+				retval=core_bench_state(res->size,res->memblock[3],res->seed1,res->seed2,dtype,res->run->crc);
+				KPROF_STOP(t,KERNEL_STATE);
+				if (res->run->crcstate==0)
+					res->run->crcstate=retval;
 				break;
 			case 1:
-				retval=core_bench_matrix(&(res->mat),dtype,res->crc);
-				if (res->crcmatrix==0)
-					res->crcmatrix=retval;
+				KPROF_START(t);
+				retval=core_bench_matrix(&(res->mat),dtype,res->run->crc);
+				KPROF_STOP(t,KERNEL_MATRIX);
+				if (res->run->crcmatrix==0)
+					res->run->crcmatrix=retval;
 				break;
 			default:
 				retval=data;
 				break;
 		}
-		res->crc=crcu16(retval,res->crc);
+		res->run->crc=crcu16(retval,res->run->crc);
 		retval &= 0x007f; 
 		*pdata = (data & 0xff00) | 0x0080 | retval; /* cache the result */
 		return retval;
@@ -372,13 +563,18 @@ ee_u16 core_bench_list(core_results *res, ee_s16 finder_idx) {
 	list_head *finder, *remover;
 	list_data info;
 	ee_s16 i;
+	KPROF_DECL(t);
 
 	info.idx=finder_idx;
 	/* find <find_num> values in the list, and change the list each time (reverse and cache if value found) */
 	for (i=0; i<find_num; i++) {
 		info.data16= (i & 0xff) ;
+		KPROF_START(t);
 		this_find=core_list_find(list,&info);
+		KPROF_STOP(t,KERNEL_LIST_FIND);
+		KPROF_START(t);
 		list=core_list_reverse(list);
+		KPROF_STOP(t,KERNEL_LIST_REVERSE);
 		if (this_find==NULL) {
 			missed++;
 			retval+=(list->next->info->data16 >> 8) & 1;
@@ -403,11 +599,16 @@ ee_u16 core_bench_list(core_results *res, ee_s16 finder_idx) {
 	}
 	retval+=found*4-missed;
 	/* sort the list by data content and remove one item*/
-	if (finder_idx>0)
+	if (finder_idx>0) {
+		KPROF_START(t);
 		list=core_list_mergesort(list,cmp_complex,res);
+		KPROF_STOP(t,KERNEL_LIST_SORT);
+	}
 	remover=core_list_remove(list->next);
 	/* CRC data content of list from location of index N forward, and then undo remove */
+	KPROF_START(t);
 	finder=core_list_find(list,&info);
+	KPROF_STOP(t,KERNEL_LIST_FIND);
 	if (!finder)
 		finder=list->next;
 	while (finder) {
@@ -419,7 +620,9 @@ ee_u16 core_bench_list(core_results *res, ee_s16 finder_idx) {
 #endif
 	remover=core_list_undo_remove(remover,list->next);
 	/* sort the list by index, in effect returning the list to original state */
+	KPROF_START(t);
 	list=core_list_mergesort(list,cmp_idx,NULL);
+	KPROF_STOP(t,KERNEL_LIST_SORT);
 	/* CRC data content of list */
 	finder=list->next;
 	while (finder) {
@@ -731,12 +934,16 @@ list_head *core_list_mergesort(list_head *list, list_cmp cmp, core_results *res)
 //------------------------------------------------------------core_list_join.c-------------------------------------------------//
 
 //------------------------------------------------------------core_matrix.c-------------------------------------------------//
-ee_s16 matrix_test(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B, MATDAT val);
+ee_s16 matrix_test(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B, MATDAT *Bt, MATDAT val);
+ee_s16 matrix_test_fused(ee_u32 N, MATDAT *A, MATDAT *B, MATDAT *Bt, MATDAT val);
 ee_s16 matrix_sum(ee_u32 N, MATRES *C, MATDAT clipval);
 void matrix_mul_const(ee_u32 N, MATRES *C, MATDAT *A, MATDAT val);
 void matrix_mul_vect(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B);
 void matrix_mul_matrix(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B);
+void matrix_mul_matrix_blocked(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B);
 void matrix_mul_matrix_bitextract(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B);
+void matrix_mul_matrix_transposed(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *Bt);
+void matrix_mul_matrix_bitextract_transposed(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *Bt);
 void matrix_add_const(ee_u32 N, MATDAT *A, MATDAT val);
 
 #define matrix_test_next(x) (x+1)
@@ -783,7 +990,10 @@ ee_u16 core_bench_matrix(mat_params *p, ee_s16 seed, ee_u16 crc) {
 	MATDAT *B=p->B;
 	MATDAT val=(MATDAT)seed;
 
-	crc=crc16(matrix_test(N,C,A,B,val),crc);
+	if (matrix_fused)
+		crc=crc16(matrix_test_fused(N,A,B,p->Bt,val),crc);
+	else
+		crc=crc16(matrix_test(N,C,A,B,p->Bt,val),crc);
 
 	return crc;
 }
@@ -796,6 +1006,7 @@ ee_u16 core_bench_matrix(mat_params *p, ee_s16 seed, ee_u16 crc) {
 	C - memory for result matrix.
 	A - input matrix
 	B - operator matrix (not changed during operations)
+	Bt - transposed copy of B, or NULL
 
 	Returns:
 	A CRC value that captures all results calculated in the function.
@@ -811,37 +1022,198 @@ ee_u16 core_bench_matrix(mat_params *p, ee_s16 seed, ee_u16 crc) {
 	5 - Add a constant value to all elements of a matrix.
 
 	After the last step, matrix A is back to original contents.
+	The steps run the selected <core_matrix_kernels>, except that the matrix multiplies
+	read Bt instead of B when it is given.
 */
-ee_s16 matrix_test(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B, MATDAT val) {
+ee_s16 matrix_test(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B, MATDAT *Bt, MATDAT val) {
 	ee_u16 crc=0;
 	MATDAT clipval=matrix_big(val);
+	KPROF_DECL(t);
 
-	matrix_add_const(N,A,val); /* make sure data changes  */
+	KPROF_START(t);
+	matrix_kernels->add_const(N,A,val); /* make sure data changes  */
+	KPROF_STOP(t,KERNEL_MATRIX_ADD_CONST);
 #if CORE_DEBUG
 	printmat(A,N,"matrix_add_const");
 #endif
-	matrix_mul_const(N,C,A,val);
+	KPROF_START(t);
+	matrix_kernels->mul_const(N,C,A,val);
+	KPROF_STOP(t,KERNEL_MATRIX_MUL_CONST);
+	KPROF_START(t);
 	crc=crc16(matrix_sum(N,C,clipval),crc);
+	KPROF_STOP(t,KERNEL_MATRIX_SUM);
 #if CORE_DEBUG
 	printmatC(C,N,"matrix_mul_const");
 #endif
-	matrix_mul_vect(N,C,A,B);
+	KPROF_START(t);
+	matrix_kernels->mul_vect(N,C,A,B);
+	KPROF_STOP(t,KERNEL_MATRIX_MUL_VECT);
+	KPROF_START(t);
 	crc=crc16(matrix_sum(N,C,clipval),crc);
+	KPROF_STOP(t,KERNEL_MATRIX_SUM);
 #if CORE_DEBUG
 	printmatC(C,N,"matrix_mul_vect");
 #endif
-	matrix_mul_matrix(N,C,A,B);
+	KPROF_START(t);
+	if (Bt)
+		matrix_mul_matrix_transposed(N,C,A,Bt);
+	else
+		matrix_kernels->mul_matrix(N,C,A,B);
+	KPROF_STOP(t,KERNEL_MATRIX_MUL_MATRIX);
+	KPROF_START(t);
 	crc=crc16(matrix_sum(N,C,clipval),crc);
+	KPROF_STOP(t,KERNEL_MATRIX_SUM);
 #if CORE_DEBUG
 	printmatC(C,N,"matrix_mul_matrix");
 #endif
-	matrix_mul_matrix_bitextract(N,C,A,B);
+	KPROF_START(t);
+	if (Bt)
+		matrix_mul_matrix_bitextract_transposed(N,C,A,Bt);
+	else
+		matrix_kernels->mul_matrix_bitextract(N,C,A,B);
+	KPROF_STOP(t,KERNEL_MATRIX_BITEXTRACT);
+	KPROF_START(t);
 	crc=crc16(matrix_sum(N,C,clipval),crc);
+	KPROF_STOP(t,KERNEL_MATRIX_SUM);
 #if CORE_DEBUG
 	printmatC(C,N,"matrix_mul_matrix_bitextract");
 #endif
 	
-	matrix_add_const(N,A,-val); /* return matrix to initial value */
+	KPROF_START(t);
+	matrix_kernels->add_const(N,A,-val); /* return matrix to initial value */
+	KPROF_STOP(t,KERNEL_MATRIX_ADD_CONST);
+	return crc;
+}
+
+/* Variable : matrix_transposed
+	Set to 1 (-transpose=1) to have <core_init_matrix> also store a transposed copy of B after C,
+	so that the matrix multiplies read both operands with unit stride. The matrices keep the
+	dimension they have without the copy, it takes <matrix_transposed_space> more bytes.
+*/
+ee_u8 matrix_transposed=0;
+
+/* Function: matrix_dim
+	Dimension of the matrices <core_init_matrix> fits in blksize bytes.
+*/
+static ee_u32 matrix_dim(ee_u32 blksize) {
+	ee_u32 i=0,j=0;
+	while (j<blksize) {
+		i++;
+		j=i*i*2*4;
+	}
+	return i-1;
+}
+/* Function: matrix_transposed_space
+	Bytes needed by the matrix data beyond blksize, for the transposed copy of B if <matrix_transposed>.
+*/
+ee_u32 matrix_transposed_space(ee_u32 blksize) {
+	ee_u32 N;
+	if (!matrix_transposed)
+		return 0;
+	N=matrix_dim(blksize);
+	return N*N*sizeof(MATDAT)+8;
+}
+
+/* Variable : matrix_fused
+	Set to 1 (-fused=1) to run <matrix_test_fused> instead of <matrix_test>.
+*/
+ee_u8 matrix_fused=0;
+
+/* Structure : matrix_sum_state
+	Accumulator of <matrix_sum>, fed one element at a time by <matrix_sum_add>.
+*/
+typedef struct MATRIX_SUM_STATE_S {
+	MATRES tmp;
+	MATRES prev;
+	ee_s16 ret;
+} matrix_sum_state;
+static inline void matrix_sum_begin(matrix_sum_state *s) {
+	s->tmp=0;
+	s->prev=0;
+	s->ret=0;
+}
+static inline void matrix_sum_add(matrix_sum_state *s, MATRES cur, MATDAT clipval) {
+	s->tmp+=cur;
+	if (s->tmp>clipval) {
+		s->ret+=10;
+		s->tmp=0;
+	} else {
+		s->ret += (cur>s->prev) ? 1 : 0;
+	}
+	s->prev=cur;
+}
+
+/* Function: matrix_test_fused
+	Same as <matrix_test>, but every step computes the elements of C in order and feeds them straight
+	into the <matrix_sum> accumulator, so C is never written or read back.
+
+	<matrix_mul_vect> only replaces the first N elements of C, the sum after it sees the products of
+	<matrix_mul_const> for the others, which are computed again. The constant adds run the selected
+	<core_matrix_kernels>, the other steps are scalar loops, with Bt when given.
+*/
+ee_s16 matrix_test_fused(ee_u32 N, MATDAT *A, MATDAT *B, MATDAT *Bt, MATDAT val) {
+	ee_u16 crc=0;
+	MATDAT clipval=matrix_big(val);
+	matrix_sum_state s;
+	ee_u32 i,j,k,n=N*N;
+	KPROF_DECL(t);
+
+	KPROF_START(t);
+	matrix_kernels->add_const(N,A,val); /* make sure data changes  */
+	KPROF_STOP(t,KERNEL_MATRIX_ADD_CONST);
+	KPROF_START(t);
+	matrix_sum_begin(&s);
+	for (i=0; i<n; i++)
+		matrix_sum_add(&s,(MATRES)A[i] * (MATRES)val,clipval);
+	crc=crc16(s.ret,crc);
+	KPROF_STOP(t,KERNEL_MATRIX_MUL_CONST);
+	KPROF_START(t);
+	matrix_sum_begin(&s);
+	for (i=0; i<N; i++) {
+		MATRES sum=0;
+		for (j=0; j<N; j++)
+			sum+=(MATRES)A[i*N+j] * (MATRES)B[j];
+		matrix_sum_add(&s,sum,clipval);
+	}
+	for (i=N; i<n; i++)
+		matrix_sum_add(&s,(MATRES)A[i] * (MATRES)val,clipval);
+	crc=crc16(s.ret,crc);
+	KPROF_STOP(t,KERNEL_MATRIX_MUL_VECT);
+	KPROF_START(t);
+	matrix_sum_begin(&s);
+	for (i=0; i<N; i++) {
+		for (j=0; j<N; j++) {
+			MATRES sum=0;
+			if (Bt) {
+				for (k=0; k<N; k++)
+					sum+=(MATRES)A[i*N+k] * (MATRES)Bt[j*N+k];
+			} else {
+				for (k=0; k<N; k++)
+					sum+=(MATRES)A[i*N+k] * (MATRES)B[k*N+j];
+			}
+			matrix_sum_add(&s,sum,clipval);
+		}
+	}
+	crc=crc16(s.ret,crc);
+	KPROF_STOP(t,KERNEL_MATRIX_MUL_MATRIX);
+	KPROF_START(t);
+	matrix_sum_begin(&s);
+	for (i=0; i<N; i++) {
+		for (j=0; j<N; j++) {
+			MATRES sum=0;
+			for (k=0; k<N; k++) {
+				MATRES tmp=(MATRES)A[i*N+k] * (MATRES)(Bt ? Bt[j*N+k] : B[k*N+j]);
+				sum+=bit_extract(tmp,2,4)*bit_extract(tmp,5,7);
+			}
+			matrix_sum_add(&s,sum,clipval);
+		}
+	}
+	crc=crc16(s.ret,crc);
+	KPROF_STOP(t,KERNEL_MATRIX_BITEXTRACT);
+
+	KPROF_START(t);
+	matrix_kernels->add_const(N,A,-val); /* return matrix to initial value */
+	KPROF_STOP(t,KERNEL_MATRIX_ADD_CONST);
 	return crc;
 }
 
@@ -853,6 +1225,7 @@ ee_s16 matrix_test(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B, MATDAT val) {
 	memblk - Pointer to memory block.
 	seed - Actual values chosen depend on the seed parameter.
 	p - pointers to <mat_params> containing initialized matrixes.
+	With <matrix_transposed>, <matrix_transposed_space> bytes beyond blksize are used as well.
 
 	Returns:
 	Matrix dimensions.
@@ -869,11 +1242,7 @@ ee_u32 core_init_matrix(ee_u32 blksize, void *memblk, ee_s32 seed, mat_params *p
 	ee_u32 i=0,j=0;
 	if (seed==0)
 		seed=1;
-	while (j<blksize) {
-		i++;
-		j=i*i*2*4;		
-	}
-	N=i-1;
+	N=matrix_dim(blksize);
 	A=(MATDAT *)align_mem(memblk);
 	B=A+N*N;
 
@@ -894,6 +1263,13 @@ ee_u32 core_init_matrix(ee_u32 blksize, void *memblk, ee_s32 seed, mat_params *p
 	p->B=B;
 	p->C=(MATRES *)align_mem(B+N*N);
 	p->N=N;
+	p->Bt=NULL;
+	if (matrix_transposed) {
+		p->Bt=(MATDAT *)(p->C+N*N);
+		for (i=0; i<N; i++)
+			for (j=0; j<N; j++)
+				p->Bt[j*N+i]=B[i*N+j];
+	}
 #if CORE_DEBUG
 	printmat(A,N,"A");
 	printmat(B,N,"B");
@@ -987,6 +1363,82 @@ void matrix_mul_matrix(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
 	}
 }
 
+/* Variable : matrix_tile, matrix_tile_rows
+	Tiles of <matrix_mul_matrix_blocked>, set from the cache sizes by <matrix_blocking_init>.
+*/
+ee_u32 matrix_tile=64;
+ee_u32 matrix_tile_rows=64;
+
+/* Function: matrix_blocking_init
+	Choose the tiles of <matrix_mul_matrix_blocked> from <portable_cache_info>.
+
+	A matrix_tile x matrix_tile tile of B takes at most half of L1, and the matrix_tile_rows x matrix_tile
+	slices of A and C it is applied to take at most half of L2. 32KB and 256KB are assumed when the
+	cache sizes are not known.
+*/
+void matrix_blocking_init(void) {
+	core_cache cache;
+	ee_u32 l1=32*1024,l2=256*1024;
+	portable_cache_info(&cache);
+	if (cache.levels>0)
+		l1=cache.size[0];
+	if (cache.levels>1)
+		l2=cache.size[1];
+	matrix_tile=8;
+	while (2*(matrix_tile*2)*(matrix_tile*2)*sizeof(MATDAT)<=l1/2)
+		matrix_tile*=2;
+	matrix_tile_rows=l2/2/(matrix_tile*(sizeof(MATDAT)+sizeof(MATRES)));
+	if (matrix_tile_rows<matrix_tile)
+		matrix_tile_rows=matrix_tile;
+}
+
+/* Function: matrix_mul_matrix_blocked
+	Same as <matrix_mul_matrix>, with the loops tiled so that B is read along its rows and a tile
+	of B stays in L1 while it is applied to a block of rows of A and C held in L2.
+	Products are summed in a different order, which gives the same results since the sums wrap.
+*/
+void matrix_mul_matrix_blocked(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 t=matrix_tile,rows=matrix_tile_rows;
+	ee_u32 i,j,k,i0,j0,k0,i1,j1,k1;
+	for (i=0; i<N*N; i++)
+		C[i]=0;
+	for (i0=0; i0<N; i0=i1) {
+		i1=(N-i0>rows) ? i0+rows : N;
+		for (k0=0; k0<N; k0=k1) {
+			k1=(N-k0>t) ? k0+t : N;
+			for (j0=0; j0<N; j0=j1) {
+				j1=(N-j0>t) ? j0+t : N;
+				for (i=i0; i<i1; i++) {
+					MATRES *c=C+i*N;
+					for (k=k0; k<k1; k++) {
+						MATRES a=(MATRES)A[i*N+k];
+						MATDAT *b=B+k*N;
+						for (j=j0; j<j1; j++)
+							c[j]+=a * (MATRES)b[j];
+					}
+				}
+			}
+		}
+	}
+}
+
+/* Function: matrix_mul_matrix_transposed
+	Same as <matrix_mul_matrix> with B given transposed, every element of C is a dot product of two rows.
+*/
+void matrix_mul_matrix_transposed(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *Bt) {
+	ee_u32 i,j,k;
+	for (i=0; i<N; i++) {
+		MATDAT *a=A+i*N;
+		for (j=0; j<N; j++) {
+			MATDAT *b=Bt+j*N;
+			MATRES sum=0;
+			for (k=0; k<N; k++)
+				sum+=(MATRES)a[k] * (MATRES)b[k];
+			C[i*N+j]=sum;
+		}
+	}
+}
+
 /* Function: matrix_mul_matrix_bitextract
 	Multiply a matrix by a matrix, and extract some bits from the result.
 	Basic code is used in many algorithms, mostly with minor changes such as scaling.
@@ -1004,6 +1456,426 @@ void matrix_mul_matrix_bitextract(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
 		}
 	}
 }
+
+/* Function: matrix_mul_matrix_bitextract_transposed
+	Same as <matrix_mul_matrix_bitextract> with B given transposed.
+*/
+void matrix_mul_matrix_bitextract_transposed(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *Bt) {
+	ee_u32 i,j,k;
+	for (i=0; i<N; i++) {
+		MATDAT *a=A+i*N;
+		for (j=0; j<N; j++) {
+			MATDAT *b=Bt+j*N;
+			MATRES sum=0;
+			for (k=0; k<N; k++) {
+				MATRES tmp=(MATRES)a[k] * (MATRES)b[k];
+				sum+=bit_extract(tmp,2,4)*bit_extract(tmp,5,7);
+			}
+			C[i*N+j]=sum;
+		}
+	}
+}
+#if MATRIX_SIMD && defined(__x86_64__)
+/* SIMD variants of the kernels, see <MATRIX_SIMD>.
+	Products of two 16b values are exact in 32b and sums wrap modulo 2^32 like the scalar code,
+	so the order of the additions does not change the results. Rows are not aligned,
+	loads and stores are unaligned and the last N%width elements of a row run the scalar code.
+
+	The bit extracts only use bits 2 to 11 of a product, which are the same in the low 16b of the
+	product, and multiply to at most 15*127. So the bitextract kernels extract and multiply 16b lanes
+	and only widen to 32b to accumulate.
+*/
+static ee_u8 matrix_sse2_supported(void) {
+	return __builtin_cpu_supports("sse2") ? 1 : 0;
+}
+/* 32b products of 8 16b lanes with a 16b constant, from the low and high halves of the 16b products */
+__attribute__((target("sse2"))) static inline void matrix_sse2_mul8(__m128i b, __m128i va, __m128i *p0, __m128i *p1) {
+	__m128i lo=_mm_mullo_epi16(b,va),hi=_mm_mulhi_epi16(b,va);
+	*p0=_mm_unpacklo_epi16(lo,hi);
+	*p1=_mm_unpackhi_epi16(lo,hi);
+}
+__attribute__((target("sse2"))) static void matrix_add_const_sse2(ee_u32 N, MATDAT *A, MATDAT val) {
+	ee_u32 i,n=N*N;
+	__m128i v=_mm_set1_epi16(val);
+	for (i=0; i+8<=n; i+=8)
+		_mm_storeu_si128((__m128i *)(A+i),_mm_add_epi16(_mm_loadu_si128((__m128i *)(A+i)),v));
+	for (; i<n; i++)
+		A[i]+=val;
+}
+__attribute__((target("sse2"))) static void matrix_mul_const_sse2(ee_u32 N, MATRES *C, MATDAT *A, MATDAT val) {
+	ee_u32 i,n=N*N;
+	__m128i v=_mm_set1_epi16(val),p0,p1;
+	for (i=0; i+8<=n; i+=8) {
+		matrix_sse2_mul8(_mm_loadu_si128((__m128i *)(A+i)),v,&p0,&p1);
+		_mm_storeu_si128((__m128i *)(C+i),p0);
+		_mm_storeu_si128((__m128i *)(C+i+4),p1);
+	}
+	for (; i<n; i++)
+		C[i]=(MATRES)A[i] * (MATRES)val;
+}
+__attribute__((target("sse2"))) static void matrix_mul_vect_sse2(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j;
+	for (i=0; i<N; i++) {
+		MATDAT *a=A+i*N;
+		__m128i acc=_mm_setzero_si128();
+		MATRES sum;
+		for (j=0; j+8<=N; j+=8)
+			acc=_mm_add_epi32(acc,_mm_madd_epi16(_mm_loadu_si128((__m128i *)(a+j)),_mm_loadu_si128((__m128i *)(B+j))));
+		acc=_mm_add_epi32(acc,_mm_shuffle_epi32(acc,_MM_SHUFFLE(1,0,3,2)));
+		acc=_mm_add_epi32(acc,_mm_shuffle_epi32(acc,_MM_SHUFFLE(2,3,0,1)));
+		sum=_mm_cvtsi128_si32(acc);
+		for (; j<N; j++)
+			sum+=(MATRES)a[j] * (MATRES)B[j];
+		C[i]=sum;
+	}
+}
+/* Rows of C are accumulated over k, so that B is read along its rows */
+__attribute__((target("sse2"))) static void matrix_mul_matrix_sse2(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j,k;
+	for (i=0; i<N; i++) {
+		MATRES *c=C+i*N;
+		for (j=0; j<N; j++)
+			c[j]=0;
+		for (k=0; k<N; k++) {
+			MATDAT a=A[i*N+k],*b=B+k*N;
+			__m128i va=_mm_set1_epi16(a),p0,p1;
+			for (j=0; j+8<=N; j+=8) {
+				matrix_sse2_mul8(_mm_loadu_si128((__m128i *)(b+j)),va,&p0,&p1);
+				_mm_storeu_si128((__m128i *)(c+j),_mm_add_epi32(_mm_loadu_si128((__m128i *)(c+j)),p0));
+				_mm_storeu_si128((__m128i *)(c+j+4),_mm_add_epi32(_mm_loadu_si128((__m128i *)(c+j+4)),p1));
+			}
+			for (; j<N; j++)
+				c[j]+=(MATRES)a * (MATRES)b[j];
+		}
+	}
+}
+/* bit_extract(tmp,2,4)*bit_extract(tmp,5,7) of 8 16b products */
+__attribute__((target("sse2"))) static inline __m128i matrix_sse2_bitextract8(__m128i lo) {
+	return _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(lo,2),_mm_set1_epi16(0xf)),_mm_and_si128(_mm_srli_epi16(lo,5),_mm_set1_epi16(0x7f)));
+}
+__attribute__((target("sse2"))) static void matrix_mul_matrix_bitextract_sse2(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j,k;
+	__m128i zero=_mm_setzero_si128();
+	for (i=0; i<N; i++) {
+		MATRES *c=C+i*N;
+		for (j=0; j<N; j++)
+			c[j]=0;
+		for (k=0; k<N; k++) {
+			MATDAT a=A[i*N+k],*b=B+k*N;
+			__m128i va=_mm_set1_epi16(a);
+			for (j=0; j+8<=N; j+=8) {
+				__m128i e=matrix_sse2_bitextract8(_mm_mullo_epi16(_mm_loadu_si128((__m128i *)(b+j)),va));
+				_mm_storeu_si128((__m128i *)(c+j),_mm_add_epi32(_mm_loadu_si128((__m128i *)(c+j)),_mm_unpacklo_epi16(e,zero)));
+				_mm_storeu_si128((__m128i *)(c+j+4),_mm_add_epi32(_mm_loadu_si128((__m128i *)(c+j+4)),_mm_unpackhi_epi16(e,zero)));
+			}
+			for (; j<N; j++) {
+				MATRES tmp=(MATRES)a * (MATRES)b[j];
+				c[j]+=bit_extract(tmp,2,4)*bit_extract(tmp,5,7);
+			}
+		}
+	}
+}
+
+static ee_u8 matrix_avx2_supported(void) {
+	return __builtin_cpu_supports("avx2") ? 1 : 0;
+}
+__attribute__((target("avx2"))) static void matrix_add_const_avx2(ee_u32 N, MATDAT *A, MATDAT val) {
+	ee_u32 i,n=N*N;
+	__m256i v=_mm256_set1_epi16(val);
+	for (i=0; i+16<=n; i+=16)
+		_mm256_storeu_si256((__m256i *)(A+i),_mm256_add_epi16(_mm256_loadu_si256((__m256i *)(A+i)),v));
+	for (; i<n; i++)
+		A[i]+=val;
+}
+__attribute__((target("avx2"))) static void matrix_mul_const_avx2(ee_u32 N, MATRES *C, MATDAT *A, MATDAT val) {
+	ee_u32 i,n=N*N;
+	__m256i v=_mm256_set1_epi32(val);
+	for (i=0; i+8<=n; i+=8)
+		_mm256_storeu_si256((__m256i *)(C+i),_mm256_mullo_epi32(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *)(A+i))),v));
+	for (; i<n; i++)
+		C[i]=(MATRES)A[i] * (MATRES)val;
+}
+__attribute__((target("avx2"))) static void matrix_mul_vect_avx2(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j;
+	for (i=0; i<N; i++) {
+		MATDAT *a=A+i*N;
+		__m256i acc=_mm256_setzero_si256();
+		__m128i h;
+		MATRES sum;
+		for (j=0; j+16<=N; j+=16)
+			acc=_mm256_add_epi32(acc,_mm256_madd_epi16(_mm256_loadu_si256((__m256i *)(a+j)),_mm256_loadu_si256((__m256i *)(B+j))));
+		h=_mm_add_epi32(_mm256_castsi256_si128(acc),_mm256_extracti128_si256(acc,1));
+		h=_mm_add_epi32(h,_mm_shuffle_epi32(h,_MM_SHUFFLE(1,0,3,2)));
+		h=_mm_add_epi32(h,_mm_shuffle_epi32(h,_MM_SHUFFLE(2,3,0,1)));
+		sum=_mm_cvtsi128_si32(h);
+		for (; j<N; j++)
+			sum+=(MATRES)a[j] * (MATRES)B[j];
+		C[i]=sum;
+	}
+}
+__attribute__((target("avx2"))) static void matrix_mul_matrix_avx2(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j,k;
+	for (i=0; i<N; i++) {
+		MATRES *c=C+i*N;
+		for (j=0; j<N; j++)
+			c[j]=0;
+		for (k=0; k<N; k++) {
+			MATDAT a=A[i*N+k],*b=B+k*N;
+			__m256i va=_mm256_set1_epi32(a);
+			for (j=0; j+8<=N; j+=8) {
+				__m256i p=_mm256_mullo_epi32(_mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *)(b+j))),va);
+				_mm256_storeu_si256((__m256i *)(c+j),_mm256_add_epi32(_mm256_loadu_si256((__m256i *)(c+j)),p));
+			}
+			for (; j<N; j++)
+				c[j]+=(MATRES)a * (MATRES)b[j];
+		}
+	}
+}
+__attribute__((target("avx2"))) static void matrix_mul_matrix_bitextract_avx2(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j,k;
+	__m256i m4=_mm256_set1_epi16(0xf),m7=_mm256_set1_epi16(0x7f);
+	for (i=0; i<N; i++) {
+		MATRES *c=C+i*N;
+		for (j=0; j<N; j++)
+			c[j]=0;
+		for (k=0; k<N; k++) {
+			MATDAT a=A[i*N+k],*b=B+k*N;
+			__m256i va=_mm256_set1_epi16(a);
+			for (j=0; j+16<=N; j+=16) {
+				__m256i lo=_mm256_mullo_epi16(_mm256_loadu_si256((__m256i *)(b+j)),va);
+				__m256i e=_mm256_mullo_epi16(_mm256_and_si256(_mm256_srli_epi16(lo,2),m4),_mm256_and_si256(_mm256_srli_epi16(lo,5),m7));
+				_mm256_storeu_si256((__m256i *)(c+j),_mm256_add_epi32(_mm256_loadu_si256((__m256i *)(c+j)),
+					_mm256_cvtepu16_epi32(_mm256_castsi256_si128(e))));
+				_mm256_storeu_si256((__m256i *)(c+j+8),_mm256_add_epi32(_mm256_loadu_si256((__m256i *)(c+j+8)),
+					_mm256_cvtepu16_epi32(_mm256_extracti128_si256(e,1))));
+			}
+			for (; j<N; j++) {
+				MATRES tmp=(MATRES)a * (MATRES)b[j];
+				c[j]+=bit_extract(tmp,2,4)*bit_extract(tmp,5,7);
+			}
+		}
+	}
+}
+
+/* GCC 12 warns about the undefined pass through operand of the avx512fintrin.h conversions and extracts */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+static ee_u8 matrix_avx512_supported(void) {
+	return (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) ? 1 : 0;
+}
+__attribute__((target("avx512f,avx512bw"))) static void matrix_add_const_avx512(ee_u32 N, MATDAT *A, MATDAT val) {
+	ee_u32 i,n=N*N;
+	__m512i v=_mm512_set1_epi16(val);
+	for (i=0; i+32<=n; i+=32)
+		_mm512_storeu_si512((void *)(A+i),_mm512_add_epi16(_mm512_loadu_si512((void *)(A+i)),v));
+	for (; i<n; i++)
+		A[i]+=val;
+}
+__attribute__((target("avx512f,avx512bw"))) static void matrix_mul_const_avx512(ee_u32 N, MATRES *C, MATDAT *A, MATDAT val) {
+	ee_u32 i,n=N*N;
+	__m512i v=_mm512_set1_epi32(val);
+	for (i=0; i+16<=n; i+=16)
+		_mm512_storeu_si512((void *)(C+i),_mm512_mullo_epi32(_mm512_cvtepi16_epi32(_mm256_loadu_si256((__m256i *)(A+i))),v));
+	for (; i<n; i++)
+		C[i]=(MATRES)A[i] * (MATRES)val;
+}
+__attribute__((target("avx512f,avx512bw"))) static void matrix_mul_vect_avx512(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j;
+	for (i=0; i<N; i++) {
+		MATDAT *a=A+i*N;
+		__m512i acc=_mm512_setzero_si512();
+		MATRES sum;
+		for (j=0; j+32<=N; j+=32)
+			acc=_mm512_add_epi32(acc,_mm512_madd_epi16(_mm512_loadu_si512((void *)(a+j)),_mm512_loadu_si512((void *)(B+j))));
+		sum=_mm512_reduce_add_epi32(acc);
+		for (; j<N; j++)
+			sum+=(MATRES)a[j] * (MATRES)B[j];
+		C[i]=sum;
+	}
+}
+__attribute__((target("avx512f,avx512bw"))) static void matrix_mul_matrix_avx512(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j,k;
+	for (i=0; i<N; i++) {
+		MATRES *c=C+i*N;
+		for (j=0; j<N; j++)
+			c[j]=0;
+		for (k=0; k<N; k++) {
+			MATDAT a=A[i*N+k],*b=B+k*N;
+			__m512i va=_mm512_set1_epi32(a);
+			for (j=0; j+16<=N; j+=16) {
+				__m512i p=_mm512_mullo_epi32(_mm512_cvtepi16_epi32(_mm256_loadu_si256((__m256i *)(b+j))),va);
+				_mm512_storeu_si512((void *)(c+j),_mm512_add_epi32(_mm512_loadu_si512((void *)(c+j)),p));
+			}
+			for (; j<N; j++)
+				c[j]+=(MATRES)a * (MATRES)b[j];
+		}
+	}
+}
+__attribute__((target("avx512f,avx512bw"))) static void matrix_mul_matrix_bitextract_avx512(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j,k;
+	__m512i m4=_mm512_set1_epi16(0xf),m7=_mm512_set1_epi16(0x7f);
+	for (i=0; i<N; i++) {
+		MATRES *c=C+i*N;
+		for (j=0; j<N; j++)
+			c[j]=0;
+		for (k=0; k<N; k++) {
+			MATDAT a=A[i*N+k],*b=B+k*N;
+			__m512i va=_mm512_set1_epi16(a);
+			for (j=0; j+32<=N; j+=32) {
+				__m512i lo=_mm512_mullo_epi16(_mm512_loadu_si512((void *)(b+j)),va);
+				__m512i e=_mm512_mullo_epi16(_mm512_and_si512(_mm512_srli_epi16(lo,2),m4),_mm512_and_si512(_mm512_srli_epi16(lo,5),m7));
+				_mm512_storeu_si512((void *)(c+j),_mm512_add_epi32(_mm512_loadu_si512((void *)(c+j)),
+					_mm512_cvtepu16_epi32(_mm512_castsi512_si256(e))));
+				_mm512_storeu_si512((void *)(c+j+16),_mm512_add_epi32(_mm512_loadu_si512((void *)(c+j+16)),
+					_mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(e,1))));
+			}
+			for (; j<N; j++) {
+				MATRES tmp=(MATRES)a * (MATRES)b[j];
+				c[j]+=bit_extract(tmp,2,4)*bit_extract(tmp,5,7);
+			}
+		}
+	}
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+#if MATRIX_SIMD && defined(__aarch64__)
+/* NEON is part of AArch64, no run time check is needed. Widening multiply accumulates keep the
+	products exact in 32b, see the x86 variants above. */
+static void matrix_add_const_neon(ee_u32 N, MATDAT *A, MATDAT val) {
+	ee_u32 i,n=N*N;
+	int16x8_t v=vdupq_n_s16(val);
+	for (i=0; i+8<=n; i+=8)
+		vst1q_s16(A+i,vaddq_s16(vld1q_s16(A+i),v));
+	for (; i<n; i++)
+		A[i]+=val;
+}
+static void matrix_mul_const_neon(ee_u32 N, MATRES *C, MATDAT *A, MATDAT val) {
+	ee_u32 i,n=N*N;
+	int16x4_t v=vdup_n_s16(val);
+	for (i=0; i+8<=n; i+=8) {
+		int16x8_t a=vld1q_s16(A+i);
+		vst1q_s32(C+i,vmull_s16(vget_low_s16(a),v));
+		vst1q_s32(C+i+4,vmull_s16(vget_high_s16(a),v));
+	}
+	for (; i<n; i++)
+		C[i]=(MATRES)A[i] * (MATRES)val;
+}
+static void matrix_mul_vect_neon(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j;
+	for (i=0; i<N; i++) {
+		MATDAT *a=A+i*N;
+		int32x4_t acc=vdupq_n_s32(0);
+		MATRES sum;
+		for (j=0; j+8<=N; j+=8) {
+			int16x8_t x=vld1q_s16(a+j),y=vld1q_s16(B+j);
+			acc=vmlal_s16(acc,vget_low_s16(x),vget_low_s16(y));
+			acc=vmlal_s16(acc,vget_high_s16(x),vget_high_s16(y));
+		}
+		sum=vaddvq_s32(acc);
+		for (; j<N; j++)
+			sum+=(MATRES)a[j] * (MATRES)B[j];
+		C[i]=sum;
+	}
+}
+static void matrix_mul_matrix_neon(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j,k;
+	for (i=0; i<N; i++) {
+		MATRES *c=C+i*N;
+		for (j=0; j<N; j++)
+			c[j]=0;
+		for (k=0; k<N; k++) {
+			MATDAT a=A[i*N+k],*b=B+k*N;
+			int16x4_t va=vdup_n_s16(a);
+			for (j=0; j+8<=N; j+=8) {
+				int16x8_t x=vld1q_s16(b+j);
+				vst1q_s32(c+j,vmlal_s16(vld1q_s32(c+j),vget_low_s16(x),va));
+				vst1q_s32(c+j+4,vmlal_s16(vld1q_s32(c+j+4),vget_high_s16(x),va));
+			}
+			for (; j<N; j++)
+				c[j]+=(MATRES)a * (MATRES)b[j];
+		}
+	}
+}
+static void matrix_mul_matrix_bitextract_neon(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
+	ee_u32 i,j,k;
+	uint16x8_t m4=vdupq_n_u16(0xf),m7=vdupq_n_u16(0x7f);
+	for (i=0; i<N; i++) {
+		MATRES *c=C+i*N;
+		for (j=0; j<N; j++)
+			c[j]=0;
+		for (k=0; k<N; k++) {
+			MATDAT a=A[i*N+k],*b=B+k*N;
+			uint16x8_t va=vdupq_n_u16((ee_u16)a);
+			for (j=0; j+8<=N; j+=8) {
+				uint16x8_t lo=vmulq_u16(vreinterpretq_u16_s16(vld1q_s16(b+j)),va);
+				uint16x8_t e=vmulq_u16(vandq_u16(vshrq_n_u16(lo,2),m4),vandq_u16(vshrq_n_u16(lo,5),m7));
+				vst1q_s32(c+j,vaddq_s32(vld1q_s32(c+j),vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(e)))));
+				vst1q_s32(c+j+4,vaddq_s32(vld1q_s32(c+j+4),vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(e)))));
+			}
+			for (; j<N; j++) {
+				MATRES tmp=(MATRES)a * (MATRES)b[j];
+				c[j]+=bit_extract(tmp,2,4)*bit_extract(tmp,5,7);
+			}
+		}
+	}
+}
+#endif
+
+/* Variable : matrix_variants
+	All <core_matrix_kernels> of the build, from the narrowest to the widest.
+	blocked is the scalar code with the cache blocked <matrix_mul_matrix_blocked>.
+*/
+static const core_matrix_kernels matrix_variants[]={
+	{"scalar",NULL,matrix_add_const,matrix_mul_const,matrix_mul_vect,matrix_mul_matrix,matrix_mul_matrix_bitextract},
+	{"blocked",NULL,matrix_add_const,matrix_mul_const,matrix_mul_vect,matrix_mul_matrix_blocked,matrix_mul_matrix_bitextract},
+#if MATRIX_SIMD && defined(__x86_64__)
+	{"sse2",matrix_sse2_supported,matrix_add_const_sse2,matrix_mul_const_sse2,matrix_mul_vect_sse2,matrix_mul_matrix_sse2,matrix_mul_matrix_bitextract_sse2},
+	{"avx2",matrix_avx2_supported,matrix_add_const_avx2,matrix_mul_const_avx2,matrix_mul_vect_avx2,matrix_mul_matrix_avx2,matrix_mul_matrix_bitextract_avx2},
+	{"avx512",matrix_avx512_supported,matrix_add_const_avx512,matrix_mul_const_avx512,matrix_mul_vect_avx512,matrix_mul_matrix_avx512,matrix_mul_matrix_bitextract_avx512},
+#endif
+#if MATRIX_SIMD && defined(__aarch64__)
+	{"neon",NULL,matrix_add_const_neon,matrix_mul_const_neon,matrix_mul_vect_neon,matrix_mul_matrix_neon,matrix_mul_matrix_bitextract_neon},
+#endif
+};
+#define NUM_MATRIX_VARIANTS (sizeof(matrix_variants)/sizeof(matrix_variants[0]))
+const core_matrix_kernels *matrix_kernels=&matrix_variants[0];
+
+/* Function: matrix_kernels_select
+	Select the matrix kernels by name, auto for the widest variant the cpu supports.
+
+	Returns:
+	The selected kernels, the current ones are kept if the name is unknown or the cpu does not support them.
+*/
+const core_matrix_kernels *matrix_kernels_select(const char *name) {
+	ee_u32 i;
+	for (i=NUM_MATRIX_VARIANTS; i-->0; ) {
+		const core_matrix_kernels *k=&matrix_variants[i];
+		ee_u8 ok=(k->supported==NULL) || k->supported();
+		if (strcmp(name,"auto")==0) {
+			if (ok)
+				return matrix_kernels=k;
+		} else if (strcmp(k->name,name)==0) {
+			if (ok)
+				return matrix_kernels=k;
+			ee_errorf("ERROR! Matrix kernels %s are not supported by this cpu, using %s\n",name,matrix_kernels->name);
+			return matrix_kernels;
+		}
+	}
+	ee_errorf("ERROR! Unknown matrix kernels %s, using %s\n",name,matrix_kernels->name);
+	return matrix_kernels;
+}
+/* Function: matrix_mul_kernels_name
+	Name of the kernels that run the matrix multiplies, scalar with <matrix_transposed> or <matrix_fused>
+	since the transposed and fused multiplies have no SIMD variant.
+*/
+const char *matrix_mul_kernels_name(void) {
+	return (matrix_transposed || matrix_fused) ? matrix_variants[0].name : matrix_kernels->name;
+}
 //--------------------------------------------------------core_matrix.c---------------------------------------------------------//
 
 //--------------------------------------------------------core_util.c---------------------------------------------------------//
@@ -1038,6 +1910,9 @@ void matrix_mul_matrix_bitextract(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B) {
 		return retval;
 	}
 #elif (SEED_METHOD==SEED_ARG)
+/* Function: parseval
+	Value of a decimal or 0x prefixed hex argument, a K or M suffix multiplies it by 1024 or 1024*1024.
+*/
 ee_s32 parseval(char *valstring) {
 	ee_s32 retval=0;
 	ee_s32 neg=1;
@@ -1188,40 +2063,2419 @@ ee_u8 check_data_types() {
 
 //------------------------------------------------------------core_util.c-------------------------------------------------//
 
-//------------------------------------------------------------core_main.c-------------------------------------------------//
-/* Function: iterate
-	Run the benchmark for a specified number of iterations.
+//------------------------------------------------------------core_portme.c-------------------------------------------------//
+#if VALIDATION_RUN
+	volatile ee_s32 seed1_volatile=0x3415;
+	volatile ee_s32 seed2_volatile=0x3415;
+	volatile ee_s32 seed3_volatile=0x66;
+#endif
+#if PERFORMANCE_RUN
+	volatile ee_s32 seed1_volatile=0x0;
+	volatile ee_s32 seed2_volatile=0x0;
+	volatile ee_s32 seed3_volatile=0x66;
+#endif
+#if PROFILE_RUN
+	volatile ee_s32 seed1_volatile=0x8;
+	volatile ee_s32 seed2_volatile=0x8;
+	volatile ee_s32 seed3_volatile=0x8;
+#endif
+	volatile ee_s32 seed4_volatile=ITERATIONS;
+	volatile ee_s32 seed5_volatile=0;
+/* Porting : Timing functions
+	How to capture time and convert to seconds must be ported to whatever is supported by the platform.
+	Each backend is a <core_timer> reading a free running tick counter.
+	The Spark firmware uses the millisecond counter. POSIX hosts can select at run time (-timer=)
+	between CLOCK_MONOTONIC_RAW (default), the calibrated TSC on x86, and clock(),
+	which is process CPU time and sums up the time of parallel contexts.
+*/
+#if (COREMARK_ARDUINO==1)
+static CORE_TICKS timer_millis_now(void) {
+	return (CORE_TICKS)millis();
+}
+static core_timer portable_timers[]={
+	{"millis",timer_millis_now,NULL,1000}
+};
+#else
+static CORE_TICKS timer_monotonic_now(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC_RAW,&t);
+	return (CORE_TICKS)t.tv_sec*1000000000ULL+(CORE_TICKS)t.tv_nsec;
+}
+static CORE_TICKS timer_clock_now(void) {
+	return (CORE_TICKS)clock();
+}
+#if defined(__x86_64__) || defined(__i386__)
+static CORE_TICKS timer_tsc_now(void) {
+	_mm_lfence(); /* do not let the read move ahead of earlier instructions */
+	return (CORE_TICKS)__rdtsc();
+}
+/* Function : timer_tsc_init
+	Calibrate the TSC frequency against CLOCK_MONOTONIC_RAW over about 100ms.
+	Each TSC read is bracketed by two clock reads and matched with their midpoint.
+*/
+static void timer_tsc_init(core_timer *t) {
+	unsigned int eax,ebx,ecx,edx;
+	CORE_TICKS ns0,ns1,ns2,ns3,c0,c1;
+	if (!__get_cpuid(0x80000007,&eax,&ebx,&ecx,&edx) || !(edx & (1<<8)))
+		ee_errorf("WARNING! TSC is not invariant, timings may drift with frequency changes.\n");
+	ns0=timer_monotonic_now();
+	c0=timer_tsc_now();
+	ns1=timer_monotonic_now();
+	do {
+		ns2=timer_monotonic_now();
+	} while (ns2-ns1<100000000ULL);
+	c1=timer_tsc_now();
+	ns3=timer_monotonic_now();
+	t->ticks_per_sec=(CORE_TICKS)((double)(c1-c0)*1e9/(double)((ns2+ns3)/2-(ns0+ns1)/2));
+}
+#endif
+static core_timer portable_timers[]={
+	{"monotonic",timer_monotonic_now,NULL,1000000000ULL},
+#if defined(__x86_64__) || defined(__i386__)
+	{"tsc",timer_tsc_now,timer_tsc_init,0},
+#endif
+	{"clock",timer_clock_now,NULL,CLOCKS_PER_SEC}
+};
+#endif
+core_timer *portable_timer=&portable_timers[0];
 
-	Operation:
-	For each type of benchmarked algorithm:
-		a - Initialize the data block for the algorithm.
-		b - Execute the algorithm N times.
+/* Function : portable_timer_select
+	Select the timer backend by name and run its calibration.
 
 	Returns:
-	NULL.
+	The selected backend, the current one is kept if the name is unknown.
 */
-static ee_u16 list_known_crc[]   =      {(ee_u16)0xd4b0,(ee_u16)0x3340,(ee_u16)0x6a79,(ee_u16)0xe714,(ee_u16)0xe3c1};
-static ee_u16 matrix_known_crc[] =      {(ee_u16)0xbe52,(ee_u16)0x1199,(ee_u16)0x5608,(ee_u16)0x1fd7,(ee_u16)0x0747};
-static ee_u16 state_known_crc[]  =      {(ee_u16)0x5e47,(ee_u16)0x39bf,(ee_u16)0xe5a4,(ee_u16)0x8e3a,(ee_u16)0x8d84};
-void *iterate(void *pres) {
+core_timer *portable_timer_select(const char *name) {
 	ee_u32 i;
-	ee_u16 crc;
-	core_results *res=(core_results *)pres;
-	ee_u32 iterations=res->iterations;
-	res->crc=0;
-	res->crclist=0;
-	res->crcmatrix=0;
-	res->crcstate=0;
+	for (i=0; i<sizeof(portable_timers)/sizeof(portable_timers[0]); i++) {
+		if (strcmp(portable_timers[i].name,name)==0) {
+			if (portable_timers[i].init)
+				portable_timers[i].init(&portable_timers[i]);
+			portable_timer=&portable_timers[i];
+			return portable_timer;
+		}
+	}
+	ee_errorf("ERROR! Unknown timer %s, using %s\n",name,portable_timer->name);
+	return portable_timer;
+}
 
-	for (i=0; i<iterations; i++) {
+/** Define Host specific (POSIX), or target specific global time variables. */
+static CORE_TICKS start_time_val, stop_time_val;
+
+/* Function : start_time
+	This function will be called right before starting the timed portion of the benchmark.
+*/
+void start_time(void) {
+	start_time_val=portable_timer->now();
+}
+/* Function : stop_time
+	This function will be called right after ending the timed portion of the benchmark.
+*/
+void stop_time(void) {
+	stop_time_val=portable_timer->now();
+}
+/* Function : get_time
+	Return an abstract "ticks" number that signifies time on the system.
+	
+	The unit depends on the selected <core_timer>, see <time_in_secs>.
+*/
+CORE_TICKS get_time(void) {
+	CORE_TICKS elapsed=stop_time_val-start_time_val;
+	return elapsed;
+}
+/* Function : time_in_secs
+	Convert the value returned by get_time to seconds.
+*/
+secs_ret time_in_secs(CORE_TICKS ticks) {
+	secs_ret retval=((secs_ret)ticks) / (secs_ret)portable_timer->ticks_per_sec;
+	return retval;
+}
+
+ee_u32 default_num_contexts=1;
+core_options portable_options={SCHED_STATIC,0,0,0,1,FORMAT_TEXT,0,0,1000,10,NULL,NULL,0,0,MEMBLOCK_LINE,NUMA_OFF,AFFINITY_NONE,0,0,0,0,{0}};
+
+#if (COREMARK_ARDUINO==0)
+static volatile sig_atomic_t soak_interrupted;
+static void soak_sigint(int sig) {
+	(void)sig;
+	soak_interrupted=1;
+}
+#endif
+/* Function : portable_soak_begin
+	Arm the stop condition of a soak run.
+	On a host Ctrl-C stops the soak instead of the process, on the Spark pending serial input is discarded.
+*/
+void portable_soak_begin(void) {
+#if (COREMARK_ARDUINO==0)
+	soak_interrupted=0;
+	signal(SIGINT,soak_sigint);
+#else
+	while (Serial.available())
+		Serial.read();
+#endif
+}
+/* Function : portable_soak_stop
+	Return non zero when a soak run should stop. Called between windows.
+	On the Spark this also services the cloud connection, and any serial input stops the soak.
+*/
+ee_u8 portable_soak_stop(void) {
+#if (COREMARK_ARDUINO==0)
+	return (ee_u8)soak_interrupted;
+#else
+	SPARK_WLAN_Loop();
+	return (Serial.available()>0);
+#endif
+}
+/* Function : portable_soak_end
+	Disarm the stop condition of a soak run.
+*/
+void portable_soak_end(void) {
+#if (COREMARK_ARDUINO==0)
+	signal(SIGINT,SIG_DFL);
+#endif
+}
+
+/* Function : portable_cpu_model
+	Copy the cpu model of the host into buf, "unknown" if it cannot be determined.
+*/
+void portable_cpu_model(char *buf, ee_u32 len) {
+#if (COREMARK_ARDUINO==0)
+	FILE *f=fopen("/proc/cpuinfo","r");
+	char line[256];
+	if (f) {
+		while (fgets(line,sizeof(line),f)) {
+			char *val=strchr(line,':');
+			if ((val==NULL) || ((strncmp(line,"model name",10)!=0) && (strncmp(line,"Processor",9)!=0)))
+				continue;
+			for (val++; *val==' '; val++)
+				;
+			val[strcspn(val,"\n")]=0;
+			strncpy(buf,val,len-1);
+			buf[len-1]=0;
+			fclose(f);
+			return;
+		}
+		fclose(f);
+	}
+#endif
+	strncpy(buf,"unknown",len-1);
+	buf[len-1]=0;
+}
+
+#if (COREMARK_ARDUINO==0)
+/* Function : portable_ref_path
+	Path of the reference crc cache: -refcache=, else $COREMARK_REF_CACHE.
+	Returns NULL if neither is set or the cache is disabled with -refcache=none, only the in memory
+	cache of <reference_crcs> is used then.
+*/
+static const char *portable_ref_path(void) {
+	const char *path=portable_options.refcache;
+	if (path==NULL)
+		path=getenv("COREMARK_REF_CACHE");
+	if ((path==NULL) || (*path==0) || (strcmp(path,"none")==0))
+		return NULL;
+	return path;
+}
+#endif
+/* Function : portable_ref_load
+	Look up the reference crcs matching the seeds, size and execs of ref in the persistent cache.
+	On a host the cache is an opt in text file with one line per entry, the Spark has no persistent cache.
+
+	Returns:
+	1 if found, with the crcs filled in, 0 otherwise.
+*/
+ee_u8 portable_ref_load(core_ref *ref) {
+#if (COREMARK_ARDUINO==0)
+	const char *path=portable_ref_path();
+	FILE *f=path ? fopen(path,"r") : NULL;
+	int s1,s2,s3;
+	unsigned int size,execs,crclist,crcmatrix,crcstate;
+	if (f==NULL)
+		return 0;
+	while (fscanf(f,"%d %d %d %u %x %x %x %x",&s1,&s2,&s3,&size,&execs,&crclist,&crcmatrix,&crcstate)==8) {
+		if ((s1==ref->seed1) && (s2==ref->seed2) && (s3==ref->seed3) && (size==ref->size) && (execs==ref->execs)) {
+			ref->crclist=(ee_u16)crclist;
+			ref->crcmatrix=(ee_u16)crcmatrix;
+			ref->crcstate=(ee_u16)crcstate;
+			fclose(f);
+			return 1;
+		}
+	}
+	fclose(f);
+#endif
+	return 0;
+}
+/* Function : portable_ref_store
+	Append computed reference crcs to the persistent cache.
+*/
+void portable_ref_store(core_ref *ref) {
+#if (COREMARK_ARDUINO==0)
+	const char *path=portable_ref_path();
+	FILE *f=path ? fopen(path,"a") : NULL;
+	if (f==NULL)
+		return;
+	fprintf(f,"%d %d %d %u %x %04x %04x %04x\n",ref->seed1,ref->seed2,ref->seed3,ref->size,ref->execs,
+		ref->crclist,ref->crcmatrix,ref->crcstate);
+	fclose(f);
+#endif
+}
+
+#if (COREMARK_ARDUINO==0)
+/* Function : portable_snapshot_path
+	File of the snapshot matching the key of snap in the -snapshot= directory.
+	Returns NULL if snapshots are disabled.
+*/
+static const char *portable_snapshot_path(core_snapshot *snap, char *buf, ee_u32 len) {
+	if (portable_options.snapshot==NULL)
+		return NULL;
+	snprintf(buf,len,"%s/coremark-%d-%d-%u-%x-%u%s.snap",portable_options.snapshot,snap->seed1,snap->seed2,
+		snap->size,snap->execs,snap->ptrsize*8,snap->layout ? "-bt" : "");
+	return buf;
+}
+#endif
+/* Function : portable_snapshot_load
+	Look up a snapshot matching the key fields of snap. On a host the file is mapped with mmap,
+	checked and copied to data, and the saved pointers are filled in to snap.
+	The Spark has no snapshots.
+
+	Returns:
+	1 if found, 0 otherwise.
+*/
+ee_u8 portable_snapshot_load(core_snapshot *snap, void *data) {
+#if (COREMARK_ARDUINO==0)
+	char buf[512];
+	const char *path=portable_snapshot_path(snap,buf,sizeof(buf));
+	core_snapshot *saved;
+	struct stat st;
+	void *map;
+	ee_u8 ret=0;
+	int fd=path ? open(path,O_RDONLY) : -1;
+	if (fd<0)
+		return 0;
+	if ((fstat(fd,&st)!=0) || ((ee_size_t)st.st_size!=sizeof(core_snapshot)+snap->len)) {
+		close(fd);
+		return 0;
+	}
+	map=mmap(NULL,(ee_size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if (map==MAP_FAILED)
+		return 0;
+	saved=(core_snapshot *)map;
+	if ((saved->magic==snap->magic) && (saved->ptrsize==snap->ptrsize) && (saved->version==snap->version) &&
+		(saved->seed1==snap->seed1) && (saved->seed2==snap->seed2) && (saved->size==snap->size) &&
+		(saved->execs==snap->execs) && (saved->layout==snap->layout) && (saved->len==snap->len)) {
+		memcpy(data,saved+1,snap->len);
+		snap->base=saved->base;
+		snap->list=saved->list;
+		snap->mat=saved->mat;
+		ret=1;
+	}
+	munmap(map,(ee_size_t)st.st_size);
+	return ret;
+#else
+	return 0;
+#endif
+}
+/* Function : portable_snapshot_store
+	Save the header snap and its data. The file is written under a temporary name and renamed,
+	so that contexts initializing in parallel never see a partial snapshot.
+*/
+void portable_snapshot_store(core_snapshot *snap, void *data) {
+#if (COREMARK_ARDUINO==0)
+	char buf[512],tmp[560];
+	const char *path=portable_snapshot_path(snap,buf,sizeof(buf));
+	FILE *f;
+	ee_u8 ok;
+	if (path==NULL)
+		return;
+	snprintf(tmp,sizeof(tmp),"%s.%ld.%p",path,(long)getpid(),data);
+	if ((f=fopen(tmp,"wb"))==NULL)
+		return;
+	ok=(fwrite(snap,sizeof(core_snapshot),1,f)==1) && (fwrite(data,snap->len,1,f)==1);
+	if ((fclose(f)!=0) || !ok || (rename(tmp,path)!=0))
+		remove(tmp);
+#endif
+}
+
+/* Function : portable_cache_info
+	Fill in the data cache sizes per level from the cache directories of every cpu in /sys/devices/system/cpu.
+	The largest size seen on any cpu is kept for every level, so hybrid parts report their big cores.
+	No levels are reported if the information is not available.
+*/
+void portable_cache_info(core_cache *c) {
+	memset(c,0,sizeof(core_cache));
+#if (COREMARK_ARDUINO==0)
+	{
+		long cpus=sysconf(_SC_NPROCESSORS_CONF),cpu;
+		ee_u32 idx;
+		for (cpu=0; cpu<cpus; cpu++) {
+			for (idx=0; ; idx++) {
+				char path[128],type[32];
+				unsigned int level=0,size=0;
+				char unit=0;
+				FILE *f;
+				snprintf(path,sizeof(path),"/sys/devices/system/cpu/cpu%ld/cache/index%u/type",cpu,idx);
+				if ((f=fopen(path,"r"))==NULL)
+					break;
+				if (fscanf(f,"%31s",type)!=1)
+					type[0]=0;
+				fclose(f);
+				if (strcmp(type,"Instruction")==0)
+					continue;
+				snprintf(path,sizeof(path),"/sys/devices/system/cpu/cpu%ld/cache/index%u/level",cpu,idx);
+				if ((f=fopen(path,"r"))!=NULL) {
+					if (fscanf(f,"%u",&level)!=1)
+						level=0;
+					fclose(f);
+				}
+				snprintf(path,sizeof(path),"/sys/devices/system/cpu/cpu%ld/cache/index%u/size",cpu,idx);
+				if ((f=fopen(path,"r"))!=NULL) {
+					if (fscanf(f,"%u%c",&size,&unit)<1)
+						size=0;
+					fclose(f);
+				}
+				if (unit=='K')
+					size*=1024;
+				else if (unit=='M')
+					size*=1024*1024;
+				if ((level<1) || (level>MAX_CACHE_LEVELS))
+					continue;
+				if (size>c->size[level-1])
+					c->size[level-1]=size;
+				if (level>c->levels)
+					c->levels=level;
+			}
+		}
+	}
+#endif
+}
+
+#if (COREMARK_ARDUINO==0)
+/* Function : portable_size_arg
+	Parse a size in bytes with an optional K, M or G suffix, end is set past the parsed text.
+*/
+static ee_u32 portable_size_arg(char *val, char **end) {
+	unsigned long v=strtoul(val,end,0);
+	switch (**end) {
+		case 'K': case 'k': v<<=10; (*end)++; break;
+		case 'M': case 'm': v<<=20; (*end)++; break;
+		case 'G': case 'g': v<<=30; (*end)++; break;
+	}
+	return (ee_u32)v;
+}
+/* Function : portable_arg
+	Return the value of a port argument of the form -name=value,
+	or NULL if arg is not that option.
+*/
+static char *portable_arg(char *arg, const char *name) {
+	size_t len=strlen(name);
+	if ((strncmp(arg+1,name,len)==0) && (arg[len+1]=='='))
+		return arg+len+2;
+	return NULL;
+}
+#endif
+
+/* Function : portable_init
+	Target specific initialization code 
+	Test for some common mistakes.
+
+	On a host, leading arguments of the form -name=value are port options:
+	-timer=monotonic|tsc|clock - timer backend, see <core_timer>.
+	-simd=scalar|blocked|sse2|avx2|avx512|neon|auto - matrix kernels, see <MATRIX_SIMD>.
+	-perf=1 - collect hardware counters, see <HAS_PERF_EVENTS>.
+	-warmup=N - number of discarded trials before the measured ones.
+	-trials=N - number of measured trials, statistics are reported if N>1.
+	-format=text|json|csv - report format, see <FORMAT_JSON>.
+	-latency=1 - per iteration latency histogram, see <LATENCY_HIST>.
+	-soak=N|forever - keep running for N seconds (or until Ctrl-C) after the benchmark, see <SOAK_FOREVER>.
+	-window=N - soak window in ms.
+	-throttle=N - soak warning threshold in percent below the first window.
+	-refcache=path|none - file caching the reference crcs of unknown run parameters, default $COREMARK_REF_CACHE or none, see <portable_ref_load>.
+	-snapshot=dir - reuse the initialized data of earlier runs from snapshot files in dir, see <portable_snapshot_load>.
+	-mem=malloc|line|page|thp|hugetlb - backend of the data blocks, see <MEMBLOCK_MALLOC>.
+	-numa=off|local|remote|both - pin contexts and bind their memory to NUMA nodes, see <NUMA_LOCAL>.
+	-affinity=none|compact|scatter|smt-pairs|all - pin contexts to cpus by topology, see <AFFINITY_COMPACT>.
+	-percpu=1 - after the benchmark, run one context pinned to every allowed cpu in turn and report the scores by core type.
+	-falseshare=1 - after the benchmark, compare the isolated contexts with a packed layout sharing cache lines.
+	-matcompare=1 - after the benchmark, time the naive against the cache blocked matrix multiply, see <matrix_compare>.
+	-transpose=1 - keep a transposed copy of B for the matrix multiplies, see <matrix_transposed>.
+	-fused=1 - run the matrix steps fused with their sums, without writing C, see <matrix_test_fused>.
+	-sweep=auto|MIN:MAX - instead of the benchmark, time each algorithm over data sizes doubling from MIN to MAX bytes
+	(K, M and G suffixes allowed), auto goes from a quarter of L1 to 4 times the last level cache.
+	-threads=N - number of contexts (0 for one per online core, capped by the online cores and <MULTITHREAD>).
+	-sched=static|steal - iteration scheduling across contexts, see <SCHED_STEAL>.
+	-scale=pow2|N,M,... - scaling curve over 1,2,4... contexts up to -threads (default all online cores), or the listed counts,
+	see <MAX_SCALE_POINTS>. The number of contexts is raised to the largest count.
+	-chunk=N - iterations per chunk for -sched=steal (0 to derive from the budget).
+
+	Port arguments are removed from argv so that the seeds keep their positions.
+*/
+void portable_init(core_portable *p, int *argc, char *argv[])
+{
+	if (sizeof(ee_ptr_int) != sizeof(ee_u8 *)) {
+		ee_printf("ERROR! Please define ee_ptr_int to a type that holds a pointer!\n");
+	}
+	if (sizeof(ee_u32) != 4) {
+		ee_printf("ERROR! Please define ee_u32 to a 32b unsigned type!\n");
+	}
+#if (COREMARK_ARDUINO==0)
+	{
+		int nargs=*argc,i;
+		char *val;
+#if USE_PTHREAD
+		ee_u32 online=(ee_u32)sysconf(_SC_NPROCESSORS_ONLN);
+		ee_u8 threads_set=0,scale_pow2=0;
+#endif
+		while ((nargs>1) && (argv[1][0]=='-') && (argv[1][1]>='a') && (argv[1][1]<='z')) {
+			if ((val=portable_arg(argv[1],"timer"))!=NULL) {
+				portable_timer_select(val);
+			} else if ((val=portable_arg(argv[1],"simd"))!=NULL) {
+				matrix_kernels_select(val);
+			} else if ((val=portable_arg(argv[1],"matcompare"))!=NULL) {
+				portable_options.matcompare=(ee_u8)atoi(val);
+			} else if ((val=portable_arg(argv[1],"transpose"))!=NULL) {
+				matrix_transposed=(ee_u8)atoi(val);
+			} else if ((val=portable_arg(argv[1],"fused"))!=NULL) {
+				matrix_fused=(ee_u8)atoi(val);
+			} else
+			if ((val=portable_arg(argv[1],"warmup"))!=NULL) {
+				portable_options.warmup=(ee_u32)atoi(val);
+			} else if ((val=portable_arg(argv[1],"trials"))!=NULL) {
+				portable_options.trials=(ee_u32)atoi(val);
+				if (portable_options.trials==0)
+					portable_options.trials=1;
+			} else if ((val=portable_arg(argv[1],"soak"))!=NULL) {
+				portable_options.soak=(strcmp(val,"forever")==0) ? SOAK_FOREVER : (ee_u32)atoi(val);
+			} else if ((val=portable_arg(argv[1],"window"))!=NULL) {
+				portable_options.soak_window=(ee_u32)atoi(val);
+				if (portable_options.soak_window==0)
+					portable_options.soak_window=1000;
+			} else if ((val=portable_arg(argv[1],"throttle"))!=NULL) {
+				portable_options.soak_throttle=(ee_u32)atoi(val);
+			} else if ((val=portable_arg(argv[1],"refcache"))!=NULL) {
+				portable_options.refcache=val;
+			} else if ((val=portable_arg(argv[1],"snapshot"))!=NULL) {
+				portable_options.snapshot=val;
+			} else if ((val=portable_arg(argv[1],"sweep"))!=NULL) {
+				char *end=val;
+				if (strcmp(val,"auto")!=0) {
+					portable_options.sweep_min=portable_size_arg(val,&end);
+					if (*end==':')
+						portable_options.sweep_max=portable_size_arg(end+1,&end);
+				}
+				if (portable_options.sweep_min==0)
+					portable_options.sweep_min=1;
+			} else if ((val=portable_arg(argv[1],"mem"))!=NULL) {
+				for (i=0; i<NUM_MEMBLOCK_METHODS; i++)
+					if (strcmp(val,memblock_names[i])==0)
+						portable_options.mem=(ee_u8)i;
+			} else
+#if HAS_NUMA
+			if ((val=portable_arg(argv[1],"numa"))!=NULL) {
+				if (strcmp(val,"local")==0)
+					portable_options.numa=NUMA_LOCAL;
+				else if (strcmp(val,"remote")==0)
+					portable_options.numa=NUMA_REMOTE;
+				else if (strcmp(val,"both")==0)
+					portable_options.numa=NUMA_BOTH;
+				else
+					portable_options.numa=NUMA_OFF;
+			} else if ((val=portable_arg(argv[1],"percpu"))!=NULL) {
+				portable_options.percpu=(ee_u8)atoi(val);
+			} else if ((val=portable_arg(argv[1],"affinity"))!=NULL) {
+				portable_options.affinity=AFFINITY_NONE;
+				for (i=0; i<=AFFINITY_ALL; i++)
+					if (strcmp(val,affinity_names[i])==0)
+						portable_options.affinity=(ee_u8)i;
+			} else
+#endif
+			if ((val=portable_arg(argv[1],"format"))!=NULL) {
+				if (strcmp(val,"json")==0)
+					portable_options.format=FORMAT_JSON;
+				else if (strcmp(val,"csv")==0)
+					portable_options.format=FORMAT_CSV;
+				else
+					portable_options.format=FORMAT_TEXT;
+			} else
+#if LATENCY_HIST
+			if ((val=portable_arg(argv[1],"latency"))!=NULL) {
+				portable_options.latency=(ee_u8)atoi(val);
+			} else
+#endif
+#if HAS_PERF_EVENTS
+			if ((val=portable_arg(argv[1],"perf"))!=NULL) {
+				portable_options.perf=(ee_u8)atoi(val);
+			} else
+#endif
+#if USE_PTHREAD
+			if ((val=portable_arg(argv[1],"threads"))!=NULL) {
+				default_num_contexts=(ee_u32)atoi(val);
+				if ((default_num_contexts==0) || (default_num_contexts>online))
+					default_num_contexts=online;
+				threads_set=1;
+			} else if ((val=portable_arg(argv[1],"scale"))!=NULL) {
+				scale_pow2=(strcmp(val,"pow2")==0);
+				portable_options.scale_points=0;
+				while (!scale_pow2 && (*val!=0) && (portable_options.scale_points<MAX_SCALE_POINTS)) {
+					ee_u32 n=(ee_u32)strtoul(val,&val,10);
+					if (n>0)
+						portable_options.scale[portable_options.scale_points++]=n;
+					if (*val!=',')
+						break;
+					val++;
+				}
+			} else if ((val=portable_arg(argv[1],"falseshare"))!=NULL) {
+				portable_options.falseshare=(ee_u8)atoi(val);
+			} else if ((val=portable_arg(argv[1],"sched"))!=NULL) {
+				portable_options.sched=(strcmp(val,"steal")==0) ? SCHED_STEAL : SCHED_STATIC;
+			} else if ((val=portable_arg(argv[1],"chunk"))!=NULL) {
+				portable_options.chunk=(ee_u32)atoi(val);
+			} else
+#endif
+			{
+				ee_errorf("ERROR! Unknown option %s\n",argv[1]);
+			}
+			/* Shift args since this one is directed to the portable part and not to coremark main */
+			--nargs;
+			for (i=1; i<nargs; i++)
+				argv[i]=argv[i+1];
+		}
+		*argc=nargs;
+#if USE_PTHREAD
+		if (scale_pow2) {
+			ee_u32 top=threads_set ? default_num_contexts : online,n;
+			for (n=1; (n<top) && (portable_options.scale_points<MAX_SCALE_POINTS-1); n*=2)
+				portable_options.scale[portable_options.scale_points++]=n;
+			portable_options.scale[portable_options.scale_points++]=top;
+		}
+		/* contexts are allocated for the largest count of the scaling curve */
+		for (i=0; i<(int)portable_options.scale_points; i++) {
+			if (portable_options.scale[i]>online)
+				portable_options.scale[i]=online;
+			if (portable_options.scale[i]>MULTITHREAD)
+				portable_options.scale[i]=MULTITHREAD;
+			if (portable_options.scale[i]>default_num_contexts)
+				default_num_contexts=portable_options.scale[i];
+		}
+#endif
+		if (default_num_contexts>MULTITHREAD)
+			default_num_contexts=MULTITHREAD;
+	}
+#endif
+	p->portable_id=1;
+}
+/* Function : portable_fini
+	Target specific final code 
+*/
+void portable_fini(core_portable *p)
+{
+	p->portable_id=0;
+}
+
+/* Function : portable_malloc
+	Provide malloc() functionality in a platform specific way.
+*/
+void *portable_malloc(ee_size_t size) {
+	return malloc(size);
+}
+/* Function : portable_free
+	Provide free() functionality in a platform specific way.
+*/
+void portable_free(void *p) {
+	free(p);
+}
+
+const char *memblock_names[NUM_MEMBLOCK_METHODS]={"malloc","line","page","thp","hugetlb"};
+/* Backend used by the last <portable_memblock_alloc>, after any fallback */
+ee_u8 portable_memblock_used=MEMBLOCK_MALLOC;
+/* Header stored right before every data block, to release it with the right backend */
+typedef struct MEMBLOCK_HDR_S {
+	void *base;
+	ee_size_t len;
+	ee_u8 method;
+} memblock_hdr;
+#define MEMBLOCK_HDR_SIZE ((sizeof(memblock_hdr)+MEMBLOCK_LINE_SIZE-1)&~(ee_size_t)(MEMBLOCK_LINE_SIZE-1))
+
+#if (COREMARK_ARDUINO==0)
+/* Function : portable_huge_page_size
+	Default huge page size from /proc/meminfo, 2MB if unknown.
+*/
+static ee_size_t portable_huge_page_size(void) {
+	static ee_size_t hps=0;
+	if (hps==0) {
+		FILE *f=fopen("/proc/meminfo","r");
+		char line[128];
+		unsigned long kb;
+		hps=2*1024*1024;
+		if (f) {
+			while (fgets(line,sizeof(line),f))
+				if (sscanf(line,"Hugepagesize: %lu kB",&kb)==1)
+					hps=(ee_size_t)kb*1024;
+			fclose(f);
+		}
+	}
+	return hps;
+}
+#endif
+/* Function : portable_memblock_alloc
+	Allocate a data block with the backend requested by <core_options.mem>, see <MEMBLOCK_MALLOC>.
+	Release it with <portable_memblock_free>.
+*/
+void *portable_memblock_alloc(ee_size_t size) {
+	return portable_memblock_alloc_with(portable_options.mem,size);
+}
+/* Function : portable_memblock_alloc_with
+	Allocate a block with the given backend, see <MEMBLOCK_MALLOC>.
+*/
+void *portable_memblock_alloc_with(ee_u8 method, ee_size_t size) {
+	ee_size_t off=MEMBLOCK_HDR_SIZE,len=size+off;
+	void *base=NULL;
+	memblock_hdr *hdr;
+#if (COREMARK_ARDUINO==0)
+	ee_size_t page=(ee_size_t)sysconf(_SC_PAGESIZE);
+	if (method==MEMBLOCK_HUGETLB) {
+#ifdef MAP_HUGETLB
+		ee_size_t hps=portable_huge_page_size();
+		len=(size+off+hps-1)&~(hps-1);
+		base=mmap(NULL,len,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+		if (base==MAP_FAILED)
+			base=NULL;
+#endif
+		if (base==NULL)
+			method=MEMBLOCK_THP;
+	}
+	if (method==MEMBLOCK_THP) {
+#ifdef MADV_HUGEPAGE
+		ee_size_t hps=portable_huge_page_size();
+		len=(size+off+hps-1)&~(hps-1);
+		if (posix_memalign(&base,hps,len)!=0)
+			base=NULL;
+		else
+			madvise(base,len,MADV_HUGEPAGE);
+#endif
+		if (base==NULL)
+			method=MEMBLOCK_PAGE;
+	}
+	if (method==MEMBLOCK_PAGE) {
+		/* a whole page ahead of the data keeps the data itself page aligned */
+		off=page;
+		len=size+off;
+		if (posix_memalign(&base,page,len)!=0) {
+			base=NULL;
+			method=MEMBLOCK_LINE;
+			off=MEMBLOCK_HDR_SIZE;
+			len=size+off;
+		}
+	}
+	if (method==MEMBLOCK_LINE) {
+		len=(len+MEMBLOCK_LINE_SIZE-1)&~(ee_size_t)(MEMBLOCK_LINE_SIZE-1);
+		if (posix_memalign(&base,MEMBLOCK_LINE_SIZE,len)!=0)
+			return NULL;
+	}
+#endif
+	if (base==NULL) {
+		method=MEMBLOCK_MALLOC;
+		base=malloc(len);
+		if (base==NULL)
+			return NULL;
+	}
+	portable_memblock_used=method;
+	hdr=(memblock_hdr *)((ee_u8 *)base+off-sizeof(memblock_hdr));
+	hdr->base=base;
+	hdr->len=len;
+	hdr->method=method;
+	return (ee_u8 *)base+off;
+}
+/* Function : portable_memblock_len
+	Bytes of a block from <portable_memblock_alloc> usable from p on, including what the backend
+	rounded the requested size up to.
+*/
+ee_size_t portable_memblock_len(void *p) {
+	memblock_hdr *hdr=(memblock_hdr *)((ee_u8 *)p-sizeof(memblock_hdr));
+	return hdr->len-(ee_size_t)((ee_u8 *)p-(ee_u8 *)hdr->base);
+}
+/* Function : portable_memblock_free
+	Release a block allocated by <portable_memblock_alloc>.
+*/
+void portable_memblock_free(void *p) {
+	memblock_hdr *hdr;
+	if (p==NULL)
+		return;
+	hdr=(memblock_hdr *)((ee_u8 *)p-sizeof(memblock_hdr));
+#if (COREMARK_ARDUINO==0)
+	if (hdr->method==MEMBLOCK_HUGETLB) {
+		munmap(hdr->base,hdr->len);
+		return;
+	}
+#endif
+	free(hdr->base);
+}
+
+#if HAS_NUMA
+const char *affinity_names[NUM_AFFINITY_POLICIES+1]={"none","compact","scatter","smt-pairs","all"};
+/* Function : portable_cpu_allowed
+	Return the n-th cpu (counting from 0) this process is allowed to run on, or -1 if there are fewer.
+*/
+ee_s32 portable_cpu_allowed(ee_u32 n) {
+	cpu_set_t set;
+	ee_s32 cpu;
+	if (sched_getaffinity(0,sizeof(set),&set)!=0)
+		return -1;
+	for (cpu=0; cpu<CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu,&set) && (n--==0))
+			return cpu;
+	return -1;
+}
+/* Topology of one allowed cpu, see <portable_affinity_order> */
+typedef struct CPU_TOPO_S {
+	ee_s32 cpu;
+	ee_s32 package;
+	ee_s32 core;
+	ee_u32 core_rank;	/* index of the core within its package */
+	ee_u32 thread;		/* index of the cpu among the SMT siblings of its core */
+	ee_u32 siblings;	/* number of allowed SMT siblings of its core */
+} cpu_topo;
+static ee_s32 portable_sysfs_int(ee_s32 cpu, const char *name) {
+	char path[96];
+	FILE *f;
+	int v=-1;
+	snprintf(path,sizeof(path),"/sys/devices/system/cpu/cpu%d/topology/%s",cpu,name);
+	if ((f=fopen(path,"r"))!=NULL) {
+		if (fscanf(f,"%d",&v)!=1)
+			v=-1;
+		fclose(f);
+	}
+	return v;
+}
+static int cmp_compact(const void *a, const void *b) {
+	const cpu_topo *x=(const cpu_topo *)a,*y=(const cpu_topo *)b;
+	if (x->package!=y->package)
+		return x->package-y->package;
+	if (x->core!=y->core)
+		return x->core-y->core;
+	return x->cpu-y->cpu;
+}
+static int cmp_scatter(const void *a, const void *b) {
+	const cpu_topo *x=(const cpu_topo *)a,*y=(const cpu_topo *)b;
+	if (x->thread!=y->thread)
+		return (int)x->thread-(int)y->thread;
+	if (x->core_rank!=y->core_rank)
+		return (int)x->core_rank-(int)y->core_rank;
+	if (x->package!=y->package)
+		return x->package-y->package;
+	return x->cpu-y->cpu;
+}
+/* Function : portable_affinity_order
+	Fill cpus with the allowed cpus in the order a placement policy uses them, see <AFFINITY_COMPACT>.
+	Cpus without topology information count as separate cores of package 0.
+
+	Returns:
+	Number of cpus filled in, 0 if the policy cannot be applied (e.g. no SMT siblings for AFFINITY_SMT_PAIRS).
+*/
+ee_u32 portable_affinity_order(ee_u8 policy, ee_s32 *cpus, ee_u32 max) {
+	cpu_topo *t=(cpu_topo *)portable_malloc(CPU_SETSIZE*sizeof(cpu_topo));
+	ee_u32 n=0,i,j,k,rank=0,count=0;
+	ee_s32 cpu;
+	while ((cpu=portable_cpu_allowed(n))>=0) {
+		t[n].cpu=cpu;
+		t[n].package=portable_sysfs_int(cpu,"physical_package_id");
+		t[n].core=portable_sysfs_int(cpu,"core_id");
+		if (t[n].package<0)
+			t[n].package=0;
+		if (t[n].core<0)
+			t[n].core=cpu;
+		n++;
+	}
+	/* in compact order siblings are adjacent and cores of a package are ascending */
+	qsort(t,n,sizeof(cpu_topo),cmp_compact);
+	for (i=0; i<n; i=j) {
+		if ((i==0) || (t[i].package!=t[i-1].package))
+			rank=0;
+		for (j=i; (j<n) && (t[j].package==t[i].package) && (t[j].core==t[i].core); j++)
+			;
+		for (k=i; k<j; k++) {
+			t[k].thread=k-i;
+			t[k].siblings=j-i;
+			t[k].core_rank=rank;
+		}
+		rank++;
+	}
+	if (policy==AFFINITY_SCATTER)
+		qsort(t,n,sizeof(cpu_topo),cmp_scatter);
+	for (i=0; (i<n) && (count<max); i++) {
+		if ((policy==AFFINITY_SMT_PAIRS) && ((t[i].siblings<2) || (t[i].thread>1)))
+			continue;
+		cpus[count++]=t[i].cpu;
+	}
+	portable_free(t);
+	return count;
+}
+/* Function : portable_cpu_class
+	Return a value telling apart the core types of a hybrid cpu: the cpu_capacity of the cpu,
+	else its maximum frequency in MHz from cpufreq, else 0. source names where it came from.
+*/
+ee_u32 portable_cpu_class(ee_u32 cpu, const char **source) {
+	char path[96];
+	FILE *f;
+	unsigned long v;
+	snprintf(path,sizeof(path),"/sys/devices/system/cpu/cpu%u/cpu_capacity",cpu);
+	if ((f=fopen(path,"r"))!=NULL) {
+		int ok=(fscanf(f,"%lu",&v)==1);
+		fclose(f);
+		if (ok) {
+			*source="cpu_capacity";
+			return (ee_u32)v;
+		}
+	}
+	snprintf(path,sizeof(path),"/sys/devices/system/cpu/cpu%u/cpufreq/cpuinfo_max_freq",cpu);
+	if ((f=fopen(path,"r"))!=NULL) {
+		int ok=(fscanf(f,"%lu",&v)==1);
+		fclose(f);
+		if (ok) {
+			*source="max MHz";
+			return (ee_u32)(v/1000);
+		}
+	}
+	*source="unknown";
+	return 0;
+}
+/* Function : portable_cpu_node
+	Return the NUMA node of a cpu, 0 if unknown.
+*/
+ee_s32 portable_cpu_node(ee_u32 cpu) {
+	char path[96];
+	ee_s32 node;
+	for (node=0; node<1024; node++) {
+		snprintf(path,sizeof(path),"/sys/devices/system/cpu/cpu%u/node%d",cpu,node);
+		if (access(path,F_OK)==0)
+			return node;
+	}
+	return 0;
+}
+/* Function : portable_numa_nodes
+	Return the number of NUMA nodes, 1 if unknown.
+*/
+ee_u32 portable_numa_nodes(void) {
+	char path[64];
+	ee_u32 node,count=0;
+	for (node=0; node<1024; node++) {
+		snprintf(path,sizeof(path),"/sys/devices/system/node/node%u",node);
+		if (access(path,F_OK)==0)
+			count=node+1;
+	}
+	return count ? count : 1;
+}
+/* Function : portable_mem_bind
+	Bind the pages holding [p,p+size) to a NUMA node with mbind (MPOL_BIND).
+	If move is set, pages already touched are migrated as well.
+	The range is widened to whole pages, so blocks should come from a page aligned backend.
+
+	Returns:
+	1 on success, 0 otherwise.
+*/
+ee_u8 portable_mem_bind(void *p, ee_size_t size, ee_u32 node, ee_u8 move) {
+	unsigned long mask[1024/(8*sizeof(unsigned long))];
+	ee_size_t page=(ee_size_t)sysconf(_SC_PAGESIZE);
+	ee_size_t start=(ee_size_t)p & ~(page-1);
+	ee_size_t end=((ee_size_t)p+size+page-1) & ~(page-1);
+	memset(mask,0,sizeof(mask));
+	mask[node/(8*sizeof(unsigned long))]|=1UL<<(node%(8*sizeof(unsigned long)));
+	/* MPOL_BIND=2, MPOL_MF_STRICT=1, MPOL_MF_MOVE=2 from linux/mempolicy.h */
+	return syscall(SYS_mbind,start,end-start,2,mask,(unsigned long)(8*sizeof(mask)),move ? 1|2 : 0)==0;
+}
+#endif
+
+#if USE_PTHREAD
+/* Function : core_start_parallel
+	Start benchmarking in a parallel context.
+	
+	Each context runs <iterate> on its own <core_results> and memory block in a separate thread.
+*/
+ee_u8 core_start_parallel(core_results *res) {
+	if (portable_options.sched==SCHED_STEAL)
+		return portable_thread_start(res,iterate_steal);
+	return portable_thread_start(res,iterate);
+}
+/* Function : portable_thread_start
+	Run fn(res) in a new thread of context res, pinned to <core_portable.cpu> if set.
+	Wait for it with <core_stop_parallel>.
+*/
+ee_u8 portable_thread_start(core_results *res, void *(*fn)(void *)) {
+	pthread_attr_t *pattr=NULL;
+	ee_u8 ret;
+#if HAS_NUMA
+	pthread_attr_t attr;
+	if (res->port.cpu>=0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(res->port.cpu,&set);
+		pthread_attr_init(&attr);
+		pthread_attr_setaffinity_np(&attr,sizeof(set),&set);
+		pattr=&attr;
+	}
+#endif
+	ret=(ee_u8)pthread_create(&(res->port.thread),pattr,fn,(void *)res);
+	if (pattr)
+		pthread_attr_destroy(pattr);
+	return ret;
+}
+/* Function : core_stop_parallel
+	Stop a parallel context execution of coremark, and gather the results.
+*/
+ee_u8 core_stop_parallel(core_results *res) {
+	void *retval;
+	return (ee_u8)pthread_join(res->port.thread,&retval);
+}
+
+/* Scheduler state shared by all contexts for <SCHED_STEAL> */
+static core_results **sched_ctx;
+static ee_u32 sched_num;
+
+/* Function : portable_sched_init
+	Split the total iteration budget (num*iterations) into chunks and deal them out
+	round robin to the per context deques.
+
+	Every context runs its first iteration on its own so it still produces
+	its own crclist/crcmatrix/crcstate, so that iteration is not part of any chunk.
+*/
+void portable_sched_init(core_results **res, ee_u32 num, ee_u32 iterations) {
+	ee_u32 total=num*(iterations-1);
+	ee_u32 chunk=portable_options.chunk;
+	ee_u32 nchunks,i;
+	if (chunk==0) /* about 8 chunks per context */
+		chunk=total/(num*8);
+	if (chunk==0)
+		chunk=1;
+	nchunks=(total+chunk-1)/chunk;
+	for (i=0; i<num; i++) {
+		core_portable *p=&(res[i]->port);
+		p->ctx=i;
+		p->deque=(ee_u32 *)portable_malloc((nchunks/num+1)*sizeof(ee_u32));
+		p->top=p->bottom=0;
+		p->steals=0;
+		pthread_mutex_init(&(p->lock),NULL);
+	}
+	for (i=0; i<nchunks; i++) {
+		core_portable *p=&(res[i%num]->port);
+		p->deque[p->bottom++]=(i==nchunks-1) ? total-i*chunk : chunk;
+	}
+	sched_ctx=res;
+	sched_num=num;
+}
+/* Function : portable_sched_next
+	Get the next chunk of iterations for a context.
+
+	The owner pops from the bottom of its own deque, and once that is empty
+	steals from the top of the other contexts' deques.
+
+	Returns:
+	Number of iterations to run, 0 once all deques are empty.
+*/
+ee_u32 portable_sched_next(core_results *res) {
+	core_portable *p=&(res->port);
+	ee_u32 n=0,i;
+	pthread_mutex_lock(&(p->lock));
+	if (p->bottom>p->top)
+		n=p->deque[--p->bottom];
+	pthread_mutex_unlock(&(p->lock));
+	for (i=1; (n==0) && (i<sched_num); i++) {
+		core_portable *victim=&(sched_ctx[(p->ctx+i)%sched_num]->port);
+		pthread_mutex_lock(&(victim->lock));
+		if (victim->bottom>victim->top)
+			n=victim->deque[victim->top++];
+		pthread_mutex_unlock(&(victim->lock));
+		if (n!=0)
+			p->steals++;
+	}
+	return n;
+}
+/* Function : portable_sched_fini
+	Release the per context deques.
+*/
+void portable_sched_fini(core_results **res, ee_u32 num) {
+	ee_u32 i;
+	for (i=0; i<num; i++) {
+		pthread_mutex_destroy(&(res[i]->port.lock));
+		portable_free(res[i]->port.deque);
+	}
+}
+#endif
+
+#if HAS_PERF_EVENTS
+static const char *perf_names[NUM_PERF_COUNTERS]={
+	"cycles","instructions","branch-misses","L1D-misses","LLC-misses","dTLB-misses"
+};
+#define PERF_CACHE(c,op,res) ((c) | ((op)<<8) | ((res)<<16))
+static const ee_u32 perf_types[NUM_PERF_COUNTERS]={
+	PERF_TYPE_HARDWARE,PERF_TYPE_HARDWARE,PERF_TYPE_HARDWARE,
+	PERF_TYPE_HW_CACHE,PERF_TYPE_HW_CACHE,PERF_TYPE_HW_CACHE
+};
+static const unsigned long long perf_configs[NUM_PERF_COUNTERS]={
+	PERF_COUNT_HW_CPU_CYCLES,PERF_COUNT_HW_INSTRUCTIONS,PERF_COUNT_HW_BRANCH_MISSES,
+	PERF_CACHE(PERF_COUNT_HW_CACHE_L1D,PERF_COUNT_HW_CACHE_OP_READ,PERF_COUNT_HW_CACHE_RESULT_MISS),
+	PERF_CACHE(PERF_COUNT_HW_CACHE_LL,PERF_COUNT_HW_CACHE_OP_READ,PERF_COUNT_HW_CACHE_RESULT_MISS),
+	PERF_CACHE(PERF_COUNT_HW_CACHE_DTLB,PERF_COUNT_HW_CACHE_OP_READ,PERF_COUNT_HW_CACHE_RESULT_MISS)
+};
+
+/* Function : portable_perf_open
+	Open the hardware counters for this process. Counters are inherited by threads created
+	afterwards, so this must be called before the parallel contexts are started.
+	Only user space is counted, which most perf_event_paranoid settings allow.
+
+	Returns:
+	1 if at least the cycle counter could be opened. Otherwise the reason is printed,
+	all counters are closed and the run continues without them.
+*/
+ee_u8 portable_perf_open(core_perf *p) {
+	struct perf_event_attr attr;
+	ee_u32 i;
+	for (i=0; i<NUM_PERF_COUNTERS; i++) {
+		memset(&attr,0,sizeof(attr));
+		attr.size=sizeof(attr);
+		attr.type=perf_types[i];
+		attr.config=perf_configs[i];
+		attr.disabled=1;
+		attr.inherit=1;
+		attr.exclude_kernel=1;
+		attr.exclude_hv=1;
+		attr.read_format=PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+		p->fd[i]=(int)syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+		p->value[i]=0;
+		if ((i==PERF_CYCLES) && (p->fd[i]<0)) {
+			ee_errorf("Perf counters    : unavailable (%s), see /proc/sys/kernel/perf_event_paranoid\n",strerror(errno));
+			return 0;
+		}
+	}
+	return 1;
+}
+/* Function : portable_perf_start
+	Reset and enable all open counters.
+*/
+void portable_perf_start(core_perf *p) {
+	ee_u32 i;
+	for (i=0; i<NUM_PERF_COUNTERS; i++) {
+		if (p->fd[i]>=0) {
+			ioctl(p->fd[i],PERF_EVENT_IOC_RESET,0);
+			ioctl(p->fd[i],PERF_EVENT_IOC_ENABLE,0);
+		}
+	}
+}
+/* Function : portable_perf_stop
+	Disable all open counters and read them, scaled up if the kernel had to multiplex them.
+*/
+void portable_perf_stop(core_perf *p) {
+	unsigned long long buf[3];
+	ee_u32 i;
+	for (i=0; i<NUM_PERF_COUNTERS; i++)
+		if (p->fd[i]>=0)
+			ioctl(p->fd[i],PERF_EVENT_IOC_DISABLE,0);
+	for (i=0; i<NUM_PERF_COUNTERS; i++) {
+		p->value[i]=0;
+		if ((p->fd[i]>=0) && (read(p->fd[i],buf,sizeof(buf))==sizeof(buf))) {
+			p->value[i]=buf[0];
+			if ((buf[2]>0) && (buf[2]<buf[1]))
+				p->value[i]=(unsigned long long)((double)buf[0]*buf[1]/buf[2]);
+		}
+	}
+}
+/* Function : portable_perf_close
+	Close all open counters.
+*/
+void portable_perf_close(core_perf *p) {
+	ee_u32 i;
+	for (i=0; i<NUM_PERF_COUNTERS; i++) {
+		if (p->fd[i]>=0)
+			close(p->fd[i]);
+		p->fd[i]=-1;
+	}
+}
+/* Function : portable_perf_report
+	Print the counters of a region with IPC and rates per iteration (or per call).
+*/
+void portable_perf_report(core_perf *p, const char *label, ee_u32 iterations) {
+	ee_u32 i;
+	ee_printf("%-17s: IPC ",label);
+	if ((p->value[PERF_CYCLES]>0) && (p->fd[PERF_INSTRUCTIONS]>=0))
+		ee_printf("%.2f",(double)p->value[PERF_INSTRUCTIONS]/p->value[PERF_CYCLES]);
+	else
+		ee_printf("n/a");
+	for (i=0; i<NUM_PERF_COUNTERS; i++) {
+		if (p->fd[i]>=0)
+			ee_printf(", %s %.1f",perf_names[i],iterations ? (double)p->value[i]/iterations : 0.0);
+		else
+			ee_printf(", %s n/a",perf_names[i]);
+	}
+	ee_printf("\n");
+}
+#endif
+//------------------------------------------------------------core_portme.c-------------------------------------------------//
+
+//------------------------------------------------------------core_main.c-------------------------------------------------//
+/* Function: iterate
+	Run the benchmark for a specified number of iterations.
+
+	Operation:
+	For each type of benchmarked algorithm:
+		a - Initialize the data block for the algorithm.
+		b - Execute the algorithm N times.
+
+	The running crcs are kept in a local <core_crcs>, or in <core_results.run> when it is set,
+	and copied to the outputs of res at the end.
+
+	Returns:
+	NULL.
+*/
+static ee_u16 list_known_crc[]   =      {(ee_u16)0xd4b0,(ee_u16)0x3340,(ee_u16)0x6a79,(ee_u16)0xe714,(ee_u16)0xe3c1};
+static ee_u16 matrix_known_crc[] =      {(ee_u16)0xbe52,(ee_u16)0x1199,(ee_u16)0x5608,(ee_u16)0x1fd7,(ee_u16)0x0747};
+static ee_u16 state_known_crc[]  =      {(ee_u16)0x5e47,(ee_u16)0x39bf,(ee_u16)0xe5a4,(ee_u16)0x8e3a,(ee_u16)0x8d84};
+void *iterate(void *pres) {
+	ee_u32 i;
+	ee_u16 crc;
+	core_results *res=(core_results *)pres;
+	ee_u32 iterations=res->iterations;
+#if LATENCY_HIST
+	core_latency *lat=portable_options.latency ? &(res->lat) : NULL;
+	CORE_TICKS lat_prev=0;
+#endif
+	core_crcs local,*shared=res->run,*run=shared ? shared : &local;
+	KPROF_DECL(t);
+	run->crc=0;
+	run->crclist=0;
+	run->crcmatrix=0;
+	run->crcstate=0;
+	res->run=run;
+#if KERNEL_PROFILE
+	kprof_begin(res);
+#endif
+	KPROF_START(t);
+#if LATENCY_HIST
+	if (lat) {
+		latency_begin(lat);
+		lat_prev=portable_timer->now();
+	}
+#endif
+
+	for (i=0; i<iterations; i++) {
 		crc=core_bench_list(res,1);
-		res->crc=crcu16(crc,res->crc);
+		run->crc=crcu16(crc,run->crc);
 		crc=core_bench_list(res,-1);
-		res->crc=crcu16(crc,res->crc);
-		if (i==0) res->crclist=res->crc;
+		run->crc=crcu16(crc,run->crc);
+		if (i==0) run->crclist=run->crc;
+#if LATENCY_HIST
+		if (lat) {
+			CORE_TICKS now=portable_timer->now();
+			latency_record(lat,now-lat_prev);
+			lat_prev=now;
+		}
+#endif
+	}
+#if KERNEL_PROFILE
+	kprof_end(res,t);
+#endif
+	res->crc=run->crc;
+	res->crclist=run->crclist;
+	res->crcmatrix=run->crcmatrix;
+	res->crcstate=run->crcstate;
+	res->run=shared;
+	return NULL;
+}
+
+#if USE_PTHREAD
+/* Function: iterate_steal
+	Run the benchmark with <SCHED_STEAL> scheduling.
+
+	The first iteration is always run by the context itself to produce its crcs,
+	the rest is taken chunk by chunk from <portable_sched_next> until the budget is used up.
+
+	Returns:
+	NULL, <core_results.iterations> is set to the number of iterations this context ran.
+*/
+void *iterate_steal(void *pres) {
+	ee_u32 i,n,done=0;
+	ee_u16 crc;
+	core_results *res=(core_results *)pres;
+#if LATENCY_HIST
+	core_latency *lat=portable_options.latency ? &(res->lat) : NULL;
+	CORE_TICKS lat_prev=0;
+#endif
+	core_crcs local,*shared=res->run,*run=shared ? shared : &local;
+	KPROF_DECL(t);
+	run->crc=0;
+	run->crclist=0;
+	run->crcmatrix=0;
+	run->crcstate=0;
+	res->run=run;
+#if KERNEL_PROFILE
+	kprof_begin(res);
+#endif
+	KPROF_START(t);
+#if LATENCY_HIST
+	if (lat) {
+		latency_begin(lat);
+		lat_prev=portable_timer->now();
+	}
+#endif
+
+	n=1;
+	do {
+		for (i=0; i<n; i++) {
+			crc=core_bench_list(res,1);
+			run->crc=crcu16(crc,run->crc);
+			crc=core_bench_list(res,-1);
+			run->crc=crcu16(crc,run->crc);
+			if (done==0) run->crclist=run->crc;
+			done++;
+#if LATENCY_HIST
+			if (lat) {
+				CORE_TICKS now=portable_timer->now();
+				latency_record(lat,now-lat_prev);
+				lat_prev=now;
+			}
+#endif
+		}
+	} while ((n=portable_sched_next(res))>0);
+#if KERNEL_PROFILE
+	kprof_end(res,t);
+#endif
+	res->crc=run->crc;
+	res->crclist=run->crclist;
+	res->crcmatrix=run->crcmatrix;
+	res->crcstate=run->crcstate;
+	res->run=shared;
+	res->iterations=done;
+	return NULL;
+}
+#endif
+
+/* Function: run_contexts
+	Run and time one pass of the benchmark on all contexts.
+
+	Every context gets the same iteration budget. With <SCHED_STEAL> the contexts share
+	the total budget, and <core_results.iterations> returns what each one actually ran.
+
+	Returns:
+	Elapsed ticks. The iterations run by all contexts are stored in total_iterations.
+*/
+static CORE_TICKS run_contexts(core_results **results, ee_u32 num, ee_u32 iterations, ee_u32 *total_iterations) {
+	ee_u32 i;
+	for (i=0 ; i<num; i++) {
+		results[i]->iterations=iterations;
+		results[i]->execs=results[0]->execs;
+	}
+#if USE_PTHREAD
+	if (portable_options.sched==SCHED_STEAL)
+		portable_sched_init(results,num,iterations);
+#endif
+	start_time();
+#if (MULTITHREAD>1)
+	for (i=0 ; i<num; i++) {
+		core_start_parallel(results[i]);
+	}
+	for (i=0 ; i<num; i++) {
+		core_stop_parallel(results[i]);
+	}
+#else
+	iterate(results[0]);
+#endif
+	stop_time();
+#if USE_PTHREAD
+	if (portable_options.sched==SCHED_STEAL)
+		portable_sched_fini(results,num);
+#endif
+	*total_iterations=0;
+	for (i=0 ; i<num; i++)
+		*total_iterations+=results[i]->iterations;
+	return get_time();
+}
+
+#if HAS_NUMA
+static const char *numa_names[4]={"off","local","remote","both"};
+/* iterations/sec of the remote pass with <NUMA_BOTH> */
+static secs_ret numa_remote_ips;
+/* Function: numa_place
+	Pin context res to the n-th allowed cpu, unless an <AFFINITY_COMPACT> policy already placed it,
+	and bind its whole memory block, as <portable_memblock_len> reports it, to the
+	NUMA node of that cpu, or to the next node if remote is set. With move, pages already in
+	use are migrated.
+*/
+static void numa_place(core_results *res, ee_u32 n, ee_u8 remote, ee_u8 move) {
+	ee_s32 node;
+	if (res->port.cpu<0)
+		res->port.cpu=portable_cpu_allowed(n);
+	node=portable_cpu_node((res->port.cpu>=0) ? res->port.cpu : 0);
+	if (remote)
+		node=(node+1)%portable_numa_nodes();
+	res->port.node=portable_mem_bind(res->memblock[0],portable_memblock_len(res->memblock[0]),node,move) ? node : -1;
+}
+/* Function: affinity_place
+	Pin the contexts to cpus in the order of a placement policy, see <AFFINITY_COMPACT>.
+	With more contexts than cpus the order wraps around, AFFINITY_NONE unpins them.
+
+	Returns:
+	0 if the policy has no cpus to offer, the contexts are then left unpinned.
+*/
+static ee_u8 affinity_place(core_results **results, ee_u32 num, ee_u8 policy) {
+	ee_s32 *cpus=(ee_s32 *)portable_malloc(CPU_SETSIZE*sizeof(ee_s32));
+	ee_u32 count=0,i;
+	if (policy!=AFFINITY_NONE)
+		count=portable_affinity_order(policy,cpus,CPU_SETSIZE);
+	for (i=0; i<num; i++)
+		results[i]->port.cpu=count ? cpus[i%count] : -1;
+	portable_free(cpus);
+	return (policy==AFFINITY_NONE) || (count>0);
+}
+#endif
+
+/* Function: snapshot_rebase
+	Move a pointer saved in a snapshot from the saved block to the block of res.
+	Returns NULL if the pointer was not inside the saved block.
+*/
+static void *snapshot_rebase(core_results *res, core_snapshot *snap, void *p) {
+	ee_u8 *b=(ee_u8 *)p;
+	if ((b<snap->base) || (b>=snap->base+snap->len))
+		return NULL;
+	return res->memblock[0]+(b-snap->base);
+}
+/* Function: snapshot_restore
+	Restore the data of a context from a snapshot, see <portable_snapshot_load>.
+	The list is walked to rebase its next and info pointers, the matrix pointers are rebased as well.
+
+	Returns:
+	1 if restored, 0 if there is no usable snapshot and the data must be built.
+*/
+static ee_u8 snapshot_restore(core_results *res, core_snapshot *snap) {
+	list_head *node;
+	if (!portable_snapshot_load(snap,res->memblock[0]))
+		return 0;
+	if (res->execs & ID_LIST) {
+		res->list=(list_head *)snapshot_rebase(res,snap,snap->list);
+		for (node=res->list; node!=NULL; node=node->next) {
+			if ((node->info=(list_data *)snapshot_rebase(res,snap,node->info))==NULL)
+				return 0;
+			if ((node->next!=NULL) && ((node->next=(list_head *)snapshot_rebase(res,snap,node->next))==NULL))
+				return 0;
+		}
+		if (res->list==NULL)
+			return 0;
+	}
+	if (res->execs & ID_MATRIX) {
+		res->mat.N=snap->mat.N;
+		res->mat.A=(MATDAT *)snapshot_rebase(res,snap,snap->mat.A);
+		res->mat.B=(MATDAT *)snapshot_rebase(res,snap,snap->mat.B);
+		res->mat.C=(MATRES *)snapshot_rebase(res,snap,snap->mat.C);
+		res->mat.Bt=(MATDAT *)snapshot_rebase(res,snap,snap->mat.Bt);
+		if ((res->mat.A==NULL) || (res->mat.B==NULL) || (res->mat.C==NULL) || ((res->mat.Bt==NULL)!=(snap->mat.Bt==NULL)))
+			return 0;
+	}
+	return 1;
+}
+
+/* Function: context_init
+	Split memblock[0] of a context between its algorithms and initialize their data
+	from the seeds, for a data size of <core_results.size> per algorithm, plus <matrix_transposed_space>
+	for the matrices.
+	With -snapshot= the data is restored from an earlier run if possible, and saved otherwise.
+*/
+static void context_init(core_results *res) {
+	core_snapshot snap;
+	ee_size_t off=0;
+	ee_u32 i;
+	for (i=0; i<NUM_ALGORITHMS; i++) {
+		if ((1<<(ee_u32)i) & res->execs) {
+			res->memblock[i+1]=res->memblock[0]+off;
+			off+=res->size;
+			if ((1<<(ee_u32)i)==ID_MATRIX)
+				off+=matrix_transposed_space(res->size);
+		}
+	}
+	res->snapshot=0;
+	if (portable_options.snapshot!=NULL) {
+		memset(&snap,0,sizeof(snap));
+		snap.magic=SNAPSHOT_MAGIC;
+		snap.ptrsize=sizeof(void *);
+		snap.version=SNAPSHOT_VERSION;
+		snap.seed1=res->seed1;
+		snap.seed2=res->seed2;
+		snap.size=res->size;
+		snap.execs=res->execs;
+		snap.layout=matrix_transposed;
+		snap.len=(ee_u32)off;
+		if (snapshot_restore(res,&snap)) {
+			res->snapshot=1;
+			return;
+		}
+	}
+	if (res->execs & ID_LIST)
+		res->list=core_list_init(res->size,(list_head *)res->memblock[1],res->seed1);
+	if (res->execs & ID_MATRIX)
+		core_init_matrix(res->size,res->memblock[2],(ee_s32)res->seed1 | (((ee_s32)res->seed2) << 16),&(res->mat));
+	if (res->execs & ID_STATE)
+		core_init_state(res->size,res->seed1,res->memblock[3]);
+	if (portable_options.snapshot!=NULL) {
+		snap.base=res->memblock[0];
+		snap.list=res->list;
+		snap.mat=res->mat;
+		portable_snapshot_store(&snap,res->memblock[0]);
+	}
+}
+
+#if USE_PTHREAD
+static void *context_init_thread(void *pres) {
+	context_init((core_results *)pres);
+	return NULL;
+}
+#endif
+/* Function: init_contexts
+	Initialize the data of all contexts. With <USE_PTHREAD> every context initializes its own
+	block in its own thread, pinned like the benchmark threads, so that the pages are first
+	touched where they are used.
+
+	Returns:
+	Elapsed ticks.
+*/
+static CORE_TICKS init_contexts(core_results **results, ee_u32 num) {
+	CORE_TICKS t0=portable_timer->now();
+	ee_u32 i;
+#if USE_PTHREAD
+	for (i=0 ; i<num; i++)
+		portable_thread_start(results[i],context_init_thread);
+	for (i=0 ; i<num; i++)
+		core_stop_parallel(results[i]);
+#else
+	for (i=0 ; i<num; i++)
+		context_init(results[i]);
+#endif
+	return portable_timer->now()-t0;
+}
+
+/* Function: scratch_context
+	Allocate a single context outside of the benchmark contexts and initialize its data
+	for the given seeds, data size per algorithm and algorithms.
+
+	Returns:
+	The context, or NULL if the memory could not be allocated. Release it with <scratch_free>.
+*/
+static core_results *scratch_context(ee_s16 seed1, ee_s16 seed2, ee_s16 seed3, ee_u32 size, ee_u32 execs) {
+	core_results *res=(core_results *)portable_malloc(sizeof(core_results));
+	if (res==NULL)
+		return NULL;
+	memset(res,0,sizeof(core_results));
+	res->seed1=seed1;
+	res->seed2=seed2;
+	res->seed3=seed3;
+	res->size=size;
+	res->execs=execs;
+	res->memblock[0]=(ee_u8 *)portable_memblock_alloc((ee_size_t)size*NUM_ALGORITHMS+matrix_transposed_space(size));
+	if (res->memblock[0]==NULL) {
+		portable_free(res);
+		return NULL;
+	}
+	context_init(res);
+	return res;
+}
+/* Function: scratch_free
+	Release a context allocated by <scratch_context>.
+*/
+static void scratch_free(core_results *res) {
+	portable_memblock_free(res->memblock[0]);
+	portable_free(res);
+}
+
+/* Function: reference_crcs
+	Compute the expected crcs for the seeds, per algorithm data size and algorithms of ref.
+
+	A scratch context is initialized from the seeds and runs one iteration of the plain kernels,
+	since the list, matrix and state crcs do not depend on the number of iterations.
+	The scalar matrix kernels, the plain B layout and the unfused <matrix_test> are used whatever -simd=,
+	-transpose= and -fused= selected, so that the variants are checked against them.
+	Results are kept in a small in memory cache and in the persistent cache of <portable_ref_load>.
+
+	Returns:
+	1 if the crcs came from a cache, 0 if they were computed.
+*/
+#define REF_CACHE_ENTRIES 4
+static core_ref ref_cache[REF_CACHE_ENTRIES];
+static ee_u32 ref_cached;
+static ee_u8 reference_crcs(core_ref *ref) {
+	const core_matrix_kernels *kernels;
+	core_results *res;
+	ee_u8 transposed=matrix_transposed,fused=matrix_fused;
+	ee_u32 i;
+	for (i=0; (i<ref_cached) && (i<REF_CACHE_ENTRIES); i++) {
+		core_ref *c=&ref_cache[i];
+		if ((c->seed1==ref->seed1) && (c->seed2==ref->seed2) && (c->seed3==ref->seed3) &&
+			(c->size==ref->size) && (c->execs==ref->execs)) {
+			*ref=*c;
+			return 1;
+		}
 	}
-	return NULL;
+	if (portable_ref_load(ref)) {
+		ref_cache[ref_cached++%REF_CACHE_ENTRIES]=*ref;
+		return 1;
+	}
+	matrix_transposed=0;
+	matrix_fused=0;
+	res=scratch_context(ref->seed1,ref->seed2,ref->seed3,ref->size,ref->execs);
+	if (res==NULL) {
+		matrix_transposed=transposed;
+		matrix_fused=fused;
+		return 0;
+	}
+	res->iterations=1;
+	kernels=matrix_kernels;
+	matrix_kernels=&matrix_variants[0];
+	iterate(res);
+	matrix_kernels=kernels;
+	matrix_transposed=transposed;
+	matrix_fused=fused;
+	ref->crclist=res->crclist;
+	ref->crcmatrix=res->crcmatrix;
+	ref->crcstate=res->crcstate;
+	scratch_free(res);
+	ref_cache[ref_cached++%REF_CACHE_ENTRIES]=*ref;
+	portable_ref_store(ref);
+	return 0;
+}
+
+#if HAS_FLOAT
+/* Function: size_str
+	Format a byte count with a K, M or G suffix when it divides evenly.
+*/
+static const char *size_str(ee_u32 v, char *buf) {
+	if ((v>=(1u<<30)) && ((v&((1u<<30)-1))==0))
+		sprintf(buf,"%uG",v>>30);
+	else if ((v>=(1u<<20)) && ((v&((1u<<20)-1))==0))
+		sprintf(buf,"%uM",v>>20);
+	else if ((v>=(1u<<10)) && ((v&((1u<<10)-1))==0))
+		sprintf(buf,"%uK",v>>10);
+	else
+		sprintf(buf,"%u",v);
+	return buf;
+}
+/* Function: sweep_kernel
+	Time calls of one algorithm on a scratch context for at least SWEEP_SECS.
+
+	Returns:
+	Seconds per call.
+*/
+#define SWEEP_SECS 0.2
+static secs_ret sweep_kernel(core_results *res, ee_u32 id) {
+	volatile ee_u16 sink=0;
+	ee_u32 calls=0;
+	secs_ret secs;
+	CORE_TICKS t0=portable_timer->now();
+	do {
+		if (id==ID_LIST)
+			sink+=core_bench_list(res,-1);
+		else if (id==ID_MATRIX)
+			sink+=core_bench_matrix(&(res->mat),(ee_s16)((calls&0xf)*0x11),0);
+		else
+			sink+=core_bench_state(res->size,res->memblock[3],res->seed1,res->seed2,0x22+(calls&0x7)*0x11,0);
+		calls++;
+		secs=time_in_secs(portable_timer->now()-t0);
+	} while (secs<SWEEP_SECS);
+	return secs/calls;
+}
+/* Function: matrix_compare
+	Time the naive <matrix_mul_matrix> against <matrix_mul_matrix_blocked> and <matrix_mul_matrix_transposed>
+	on the matrices of a scratch context with the seeds and data size of the run, and check that all give the same C.
+	Throughput is in millions of multiply-adds per second, N^3 per call.
+
+	Then whole calls of <matrix_test> are timed against <matrix_test_fused>, with the bytes of C
+	the unfused steps write and read back, and the C traffic per second that makes. Their crcs
+	are taken outside the timing over the same 16 values of val, as <core_bench_matrix> cycles them.
+
+	Returns:
+	1 if the results differ.
+*/
+#define MATCOMPARE_SECS 0.5
+#define MATCOMPARE_WAYS 3
+static ee_u32 matrix_compare(core_results *base) {
+	static const char *names[MATCOMPARE_WAYS]={"naive","blocked","transposed"};
+	void (*fn[MATCOMPARE_WAYS])(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B)={matrix_mul_matrix,matrix_mul_matrix_blocked,matrix_mul_matrix_transposed};
+	ee_u8 transposed=matrix_transposed;
+	core_results *res;
+	ee_u16 crc[MATCOMPARE_WAYS],tcrc[2]={0,0};
+	secs_ret mmacs[MATCOMPARE_WAYS],tcalls[2],ctraffic;
+	ee_u8 format=portable_options.format,differ=0;
+	ee_u32 N,k,i,calls;
+	matrix_transposed=1;
+	res=scratch_context(base->seed1,base->seed2,base->seed3,base->size,ID_MATRIX);
+	matrix_transposed=transposed;
+	if ((res==NULL) || !(base->execs & ID_MATRIX)) {
+		ee_errorf("ERROR! No matrix to compare\n");
+		if (res)
+			scratch_free(res);
+		return 1;
+	}
+	N=res->mat.N;
+	for (k=0; k<MATCOMPARE_WAYS; k++) {
+		MATDAT *B=(fn[k]==matrix_mul_matrix_transposed) ? res->mat.Bt : res->mat.B;
+		CORE_TICKS t0=portable_timer->now();
+		secs_ret secs;
+		calls=0;
+		do {
+			fn[k](N,res->mat.C,res->mat.A,B);
+			calls++;
+			secs=time_in_secs(portable_timer->now()-t0);
+		} while (secs<MATCOMPARE_SECS);
+		mmacs[k]=(secs_ret)calls*N*N*N/secs/1e6;
+		crc[k]=0;
+		for (i=0; i<N*N; i++)
+			crc[k]=crcu32((ee_u32)res->mat.C[i],crc[k]);
+		differ|=(crc[k]!=crc[0]);
+	}
+	/* C of matrix_test: 3 full writes and the N elements of matrix_mul_vect, 4 full reads by matrix_sum */
+	ctraffic=(secs_ret)(7*N*N+N)*sizeof(MATRES);
+	for (k=0; k<2; k++) {
+		CORE_TICKS t0=portable_timer->now();
+		secs_ret secs;
+		calls=0;
+		do {
+			MATDAT val=(MATDAT)((calls&0xf)*0x11);
+			if (k)
+				matrix_test_fused(N,res->mat.A,res->mat.B,NULL,val);
+			else
+				matrix_test(N,res->mat.C,res->mat.A,res->mat.B,NULL,val);
+			calls++;
+			secs=time_in_secs(portable_timer->now()-t0);
+		} while ((secs<MATCOMPARE_SECS) || (calls<16));
+		tcalls[k]=calls/secs;
+		for (i=0; i<16; i++) {
+			MATDAT val=(MATDAT)(i*0x11);
+			tcrc[k]=crc16(k ? matrix_test_fused(N,res->mat.A,res->mat.B,NULL,val) :
+				matrix_test(N,res->mat.C,res->mat.A,res->mat.B,NULL,val),tcrc[k]);
+		}
+	}
+	differ|=(tcrc[0]!=tcrc[1]);
+	scratch_free(res);
+	if (format==FORMAT_JSON) {
+		ee_printf("{\"matrix_compare\":{\"N\":%u,\"tile\":%u,\"tile_rows\":%u",N,matrix_tile,matrix_tile_rows);
+		for (k=0; k<MATCOMPARE_WAYS; k++)
+			ee_printf(",\"%s_mmac_per_sec\":%f,\"%s_speedup\":%f,\"crc_%s\":\"0x%04x\"",names[k],mmacs[k],
+				names[k],(mmacs[0]>0) ? mmacs[k]/mmacs[0] : 0.0,names[k],crc[k]);
+		ee_printf(",\"c_bytes_per_test\":%.0f,\"unfused_tests_per_sec\":%f,\"unfused_c_bytes_per_sec\":%f,\"fused_tests_per_sec\":%f,\"fused_speedup\":%f,\"crc_unfused\":\"0x%04x\",\"crc_fused\":\"0x%04x\"}}\n",
+			ctraffic,tcalls[0],tcalls[0]*ctraffic,tcalls[1],(tcalls[0]>0) ? tcalls[1]/tcalls[0] : 0.0,tcrc[0],tcrc[1]);
+	} else if (format==FORMAT_CSV) {
+		ee_printf("matmul,N,tile,tile_rows,mmac_per_sec,speedup,crc\n");
+		for (k=0; k<MATCOMPARE_WAYS; k++)
+			ee_printf("%s,%u,%u,%u,%f,%f,0x%04x\n",names[k],N,matrix_tile,matrix_tile_rows,mmacs[k],
+				(mmacs[0]>0) ? mmacs[k]/mmacs[0] : 0.0,crc[k]);
+		ee_printf("matrix_test,N,c_bytes_per_test,tests_per_sec,c_bytes_per_sec,speedup,crc\n");
+		ee_printf("unfused,%u,%.0f,%f,%f,1.0,0x%04x\n",N,ctraffic,tcalls[0],tcalls[0]*ctraffic,tcrc[0]);
+		ee_printf("fused,%u,0,%f,0,%f,0x%04x\n",N,tcalls[1],(tcalls[0]>0) ? tcalls[1]/tcalls[0] : 0.0,tcrc[1]);
+	} else {
+		ee_printf("Matrix multiply  : N=%u, %ux%u tiles of B, blocks of %u rows\n",N,matrix_tile,matrix_tile,matrix_tile_rows);
+		for (k=0; k<MATCOMPARE_WAYS; k++)
+			ee_printf("  %-14s : %f Mmac/sec, %.2fx, crc 0x%04x%s\n",names[k],mmacs[k],(mmacs[0]>0) ? mmacs[k]/mmacs[0] : 0.0,
+				crc[k],(crc[k]!=crc[0]) ? " ERROR! results differ" : "");
+		ee_printf("Matrix test      : unfused writes and reads back %.0f bytes of C per call, fused none\n",ctraffic);
+		ee_printf("  unfused        : %f calls/sec, %f MB/sec of C, crc 0x%04x\n",tcalls[0],tcalls[0]*ctraffic/1e6,tcrc[0]);
+		ee_printf("  fused          : %f calls/sec, %.2fx, crc 0x%04x%s\n",tcalls[1],(tcalls[0]>0) ? tcalls[1]/tcalls[0] : 0.0,
+			tcrc[1],(tcrc[0]!=tcrc[1]) ? " ERROR! results differ" : "");
+	}
+	return differ;
+}
+/* Function: size_sweep
+	Time each algorithm alone over data sizes doubling from <core_options.sweep_min> to <core_options.sweep_max>
+	bytes per algorithm, and mark the sizes where each cache level of <portable_cache_info> runs out.
+
+	Throughput is the data size of the algorithm processed per second of one call.
+	The machine readable formats give the smallest cache level holding the data, 0 for memory.
+	Since the matrix work grows with the cube of its dimension, an algorithm is skipped at the larger
+	sizes once a single call takes more than SWEEP_CALL_LIMIT seconds.
+*/
+#define SWEEP_CALL_LIMIT 1.0
+static void size_sweep(core_results *base) {
+	static const char *names[NUM_ALGORITHMS]={"list","matrix","state"};
+	static const ee_u32 ids[NUM_ALGORITHMS]={ID_LIST,ID_MATRIX,ID_STATE};
+	core_cache cache;
+	ee_u32 size,lo=portable_options.sweep_min,hi=portable_options.sweep_max,level=0,k;
+	ee_u8 skip[NUM_ALGORITHMS]={0,0,0};
+	ee_u8 format=portable_options.format;
+	char b1[16],b2[16];
+
+	portable_cache_info(&cache);
+	if (lo<=1)
+		lo=(cache.levels>0) ? cache.size[0]/4 : 1024;
+	if (lo<256)
+		lo=256;
+	if (hi==0)
+		hi=(cache.levels>0) ? cache.size[cache.levels-1]*4 : 64*1024*1024;
+	if (format==FORMAT_TEXT) {
+		ee_printf("Size sweep       : %s to %s per algorithm, seeds 0x%x 0x%x 0x%x\n",size_str(lo,b1),size_str(hi,b2),
+			(ee_u16)base->seed1,(ee_u16)base->seed2,(ee_u16)base->seed3);
+		for (k=0; k<cache.levels; k++)
+			if (cache.size[k])
+				ee_printf("Cache L%u         : %s\n",k+1,size_str(cache.size[k],b1));
+		ee_printf("Memory backend   : %s\n",memblock_names[portable_options.mem]);
+		ee_printf("  %-8s","size");
+		for (k=0; k<NUM_ALGORITHMS; k++)
+			if (base->execs & ids[k])
+				ee_printf(" %12s %10s",names[k],"MB/s");
+		ee_printf("\n  %-8s","");
+		for (k=0; k<NUM_ALGORITHMS; k++)
+			if (base->execs & ids[k])
+				ee_printf(" %12s %10s","us/call","");
+		ee_printf("\n");
+	} else if (format==FORMAT_CSV) {
+		ee_printf("size,cache_level,algorithm,us_per_call,mb_per_sec\n");
+	}
+	for (size=lo; (size<=hi) && (size>=lo); size*=2) {
+		core_results *res=scratch_context(base->seed1,base->seed2,base->seed3,size,base->execs);
+		secs_ret per[NUM_ALGORITHMS];
+		while ((level<cache.levels) && (size>cache.size[level])) {
+			if ((format==FORMAT_TEXT) && cache.size[level])
+				ee_printf("  ---- L%u (%s) exhausted ----\n",level+1,size_str(cache.size[level],b1));
+			level++;
+		}
+		if (res==NULL) {
+			ee_errorf("ERROR! Cannot allocate %s per algorithm, sweep stopped\n",size_str(size,b1));
+			break;
+		}
+		for (k=0; k<NUM_ALGORITHMS; k++) {
+			per[k]=0;
+			if ((base->execs & ids[k]) && !skip[k]) {
+				per[k]=sweep_kernel(res,ids[k]);
+				if (per[k]>SWEEP_CALL_LIMIT)
+					skip[k]=1;
+			}
+		}
+		scratch_free(res);
+		if (format==FORMAT_TEXT) {
+			ee_printf("  %-8s",size_str(size,b1));
+			for (k=0; k<NUM_ALGORITHMS; k++) {
+				if (!(base->execs & ids[k]))
+					continue;
+				if (per[k]>0)
+					ee_printf(" %12.3f %10.1f",per[k]*1e6,size/per[k]/1e6);
+				else
+					ee_printf(" %12s %10s","skipped","");
+			}
+			ee_printf("\n");
+		} else {
+			for (k=0; k<NUM_ALGORITHMS; k++) {
+				if (!(base->execs & ids[k]) || (per[k]<=0))
+					continue;
+				if (format==FORMAT_JSON)
+					ee_printf("{\"size\":%u,\"cache_level\":%u,\"algorithm\":\"%s\",\"us_per_call\":%f,\"mb_per_sec\":%f}\n",
+						size,(level<cache.levels) ? level+1 : 0,names[k],per[k]*1e6,size/per[k]/1e6);
+				else
+					ee_printf("%u,%u,%s,%f,%f\n",size,(level<cache.levels) ? level+1 : 0,names[k],per[k]*1e6,size/per[k]/1e6);
+			}
+		}
+	}
+}
+
+#if HAS_NUMA
+/* Function: affinity_compare
+	Run the contexts unpinned and under every placement policy of <AFFINITY_COMPACT>,
+	checking the crcs of every run, and report the scores relative to the unpinned run.
+	The contexts are left unpinned.
+
+	Returns:
+	Number of runs with crc errors.
+*/
+static ee_u32 affinity_compare(core_results **results, ee_u32 num, ee_u32 iterations, core_ref *expected) {
+	secs_ret base=0;
+	ee_u32 policy,i,errors=0;
+	ee_u8 format=portable_options.format;
+	if (format==FORMAT_TEXT) {
+		ee_printf("Affinity policies: %u contexts, %u iterations per context\n",num,iterations);
+		ee_printf("  %-10s %16s %10s %s\n","policy","it/s total","vs none","crcs");
+	} else if (format==FORMAT_CSV) {
+		ee_printf("affinity,iterations_per_sec,delta_percent,crc_errors\n");
+	}
+	for (policy=AFFINITY_NONE; policy<NUM_AFFINITY_POLICIES; policy++) {
+		ee_u32 total,bad=0;
+		secs_ret secs,ips;
+		if (!affinity_place(results,num,(ee_u8)policy)) {
+			if (format==FORMAT_TEXT)
+				ee_printf("  %-10s %16s\n",affinity_names[policy],"n/a");
+			continue;
+		}
+		secs=time_in_secs(run_contexts(results,num,iterations,&total));
+		ips=(secs>0) ? total/secs : 0;
+		if (policy==AFFINITY_NONE)
+			base=ips;
+		for (i=0; i<num; i++) {
+			if (((results[i]->execs & ID_LIST) && (results[i]->crclist!=expected->crclist)) ||
+				((results[i]->execs & ID_MATRIX) && (results[i]->crcmatrix!=expected->crcmatrix)) ||
+				((results[i]->execs & ID_STATE) && (results[i]->crcstate!=expected->crcstate)))
+				bad++;
+		}
+		if (bad)
+			errors++;
+		if (format==FORMAT_JSON)
+			ee_printf("{\"affinity\":\"%s\",\"iterations_per_sec\":%f,\"delta_percent\":%f,\"crc_errors\":%u}\n",
+				affinity_names[policy],ips,(base>0) ? 100.0*(ips-base)/base : 0.0,bad);
+		else if (format==FORMAT_CSV)
+			ee_printf("%s,%f,%f,%u\n",affinity_names[policy],ips,(base>0) ? 100.0*(ips-base)/base : 0.0,bad);
+		else
+			ee_printf("  %-10s %16.3f %+9.2f%% %s\n",affinity_names[policy],ips,(base>0) ? 100.0*(ips-base)/base : 0.0,bad ? "ERROR" : "ok");
+	}
+	affinity_place(results,num,AFFINITY_NONE);
+	return errors;
+}
+#endif
+
+#if HAS_NUMA
+/* Function: percpu_scores
+	Run one context pinned to every allowed cpu in turn and report the scores grouped by
+	core type (<portable_cpu_class>), highest class first, with the mean of every group.
+	The crcs of every run are checked. The placement of context 0 is restored afterwards.
+
+	Returns:
+	Number of runs with crc errors.
+*/
+typedef struct CPU_SCORE_S {
+	ee_s32 cpu;
+	ee_u32 cls;
+	secs_ret ips;
+	ee_u8 bad;
+} cpu_score;
+static ee_u32 percpu_scores(core_results **results, ee_u32 iterations, core_ref *expected) {
+	ee_u32 ncpu=0,i,j,k,errors=0;
+	ee_s32 saved=results[0]->port.cpu;
+	cpu_score *sc;
+	const char *source="unknown";
+	ee_u8 format=portable_options.format;
+	while (portable_cpu_allowed(ncpu)>=0)
+		ncpu++;
+	sc=(cpu_score *)portable_malloc(ncpu*sizeof(cpu_score));
+	for (i=0; i<ncpu; i++) {
+		ee_u32 total;
+		secs_ret secs;
+		sc[i].cpu=portable_cpu_allowed(i);
+		sc[i].cls=portable_cpu_class(sc[i].cpu,&source);
+		results[0]->port.cpu=sc[i].cpu;
+		secs=time_in_secs(run_contexts(results,1,iterations,&total));
+		sc[i].ips=(secs>0) ? total/secs : 0;
+		sc[i].bad=((results[0]->execs & ID_LIST) && (results[0]->crclist!=expected->crclist)) ||
+			((results[0]->execs & ID_MATRIX) && (results[0]->crcmatrix!=expected->crcmatrix)) ||
+			((results[0]->execs & ID_STATE) && (results[0]->crcstate!=expected->crcstate));
+		if (sc[i].bad)
+			errors++;
+	}
+	results[0]->port.cpu=saved;
+	/* group by class, highest first, cpus ascending within a group */
+	for (i=1; i<ncpu; i++) {
+		cpu_score t=sc[i];
+		for (j=i; (j>0) && (sc[j-1].cls<t.cls); j--)
+			sc[j]=sc[j-1];
+		sc[j]=t;
+	}
+	if (format==FORMAT_TEXT)
+		ee_printf("Per cpu scores   : %u iterations, grouped by %s\n",iterations,source);
+	else if (format==FORMAT_CSV)
+		ee_printf("cpu,class,class_source,iterations_per_sec,crc_errors\n");
+	for (i=0; i<ncpu; i=j) {
+		secs_ret sum=0;
+		for (j=i; (j<ncpu) && (sc[j].cls==sc[i].cls); j++)
+			sum+=sc[j].ips;
+		if (format==FORMAT_TEXT)
+			ee_printf("  class %-6u    : %u cpus, mean %f iterations/sec\n",sc[i].cls,j-i,sum/(j-i));
+		for (k=i; k<j; k++) {
+			if (format==FORMAT_JSON)
+				ee_printf("{\"cpu\":%d,\"class\":%u,\"class_source\":\"%s\",\"iterations_per_sec\":%f,\"crc_errors\":%u}\n",
+					sc[k].cpu,sc[k].cls,source,sc[k].ips,sc[k].bad);
+			else if (format==FORMAT_CSV)
+				ee_printf("%d,%u,%s,%f,%u\n",sc[k].cpu,sc[k].cls,source,sc[k].ips,sc[k].bad);
+			else
+				ee_printf("    cpu %-6d   : %f iterations/sec%s\n",sc[k].cpu,sc[k].ips,sc[k].bad ? " ERROR! crc mismatch" : "");
+		}
+	}
+	portable_free(sc);
+	return errors;
+}
+#endif
+
+#if USE_PTHREAD
+/* Function: false_sharing_probe
+	Measure what sharing cache lines between contexts costs.
+
+	The contexts normally each sit on their own cache lines, data included, and keep their running
+	crcs on the stack of <iterate>. The probe builds a packed copy of them: the running <core_crcs>
+	of all contexts in one array, 8 bytes apart and shifted off a line boundary so that up to
+	MEMBLOCK_LINE_SIZE/8 contexts write the same line on every <calc_func>, and all data blocks as
+	adjacent slices of one block, so that neighbouring contexts also share the lines at the ends of
+	their list, matrix and state data. The isolated and packed layouts are run back to back with the
+	same iterations, the crcs of both are checked, and the difference is reported.
+
+	Returns:
+	Number of runs with crc errors.
+*/
+#define FALSE_SHARING_SHIFT 24
+#define FALSE_SHARING_ALIGN(n) (((n)+sizeof(void *)-1) & ~(ee_size_t)(sizeof(void *)-1))
+static ee_u32 false_sharing_probe(core_results **results, ee_u32 num, ee_u32 iterations, core_ref *expected) {
+	ee_u32 size=results[0]->size,algs=0,i,k,total,errors=0;
+	ee_size_t slice,shift=FALSE_SHARING_ALIGN(FALSE_SHARING_SHIFT);
+	ee_u8 *packed,*data,*crcs;
+	core_results **view;
+	secs_ret secs,ips[2];
+	ee_u8 format=portable_options.format;
+	for (i=0; i<NUM_ALGORITHMS; i++)
+		if ((1<<(ee_u32)i) & results[0]->execs)
+			algs++;
+	/* keep the list nodes of every slice pointer aligned */
+	slice=FALSE_SHARING_ALIGN((ee_size_t)size*algs+matrix_transposed_space(size));
+	packed=(ee_u8 *)portable_memblock_alloc_with(MEMBLOCK_LINE,num*sizeof(core_results));
+	crcs=(ee_u8 *)portable_memblock_alloc_with(MEMBLOCK_LINE,num*sizeof(core_crcs)+shift);
+	data=(ee_u8 *)portable_memblock_alloc_with(MEMBLOCK_LINE,num*slice+shift);
+	view=(core_results **)portable_malloc(num*sizeof(core_results *));
+	if ((packed==NULL) || (crcs==NULL) || (data==NULL) || (view==NULL)) {
+		ee_errorf("ERROR! Cannot allocate the false sharing probe\n");
+		portable_memblock_free(packed);
+		portable_memblock_free(crcs);
+		portable_memblock_free(data);
+		portable_free(view);
+		return 1;
+	}
+	for (i=0; i<num; i++) {
+		core_results *res=(core_results *)(packed+i*sizeof(core_results));
+		memset(res,0,sizeof(core_results));
+		res->seed1=results[i]->seed1;
+		res->seed2=results[i]->seed2;
+		res->seed3=results[i]->seed3;
+		res->size=size;
+		res->execs=results[i]->execs;
+#if HAS_NUMA
+		res->port.cpu=results[i]->port.cpu;
+		res->port.node=-1;
+#endif
+		res->memblock[0]=data+shift+i*slice;
+		res->run=(core_crcs *)(crcs+shift)+i;
+		context_init(res);
+		view[i]=res;
+	}
+	for (k=0; k<2; k++) {
+		core_results **r=k ? view : results;
+		secs=time_in_secs(run_contexts(r,num,iterations,&total));
+		ips[k]=(secs>0) ? total/secs : 0;
+		for (i=0; i<num; i++) {
+			if (((r[i]->execs & ID_LIST) && (r[i]->crclist!=expected->crclist)) ||
+				((r[i]->execs & ID_MATRIX) && (r[i]->crcmatrix!=expected->crcmatrix)) ||
+				((r[i]->execs & ID_STATE) && (r[i]->crcstate!=expected->crcstate))) {
+				errors++;
+				break;
+			}
+		}
+	}
+	if (format==FORMAT_JSON)
+		ee_printf("{\"false_sharing\":{\"contexts\":%u,\"isolated_iterations_per_sec\":%f,\"packed_iterations_per_sec\":%f,\"delta_percent\":%f,\"crc_errors\":%u}}\n",
+			num,ips[0],ips[1],(ips[0]>0) ? 100.0*(ips[1]-ips[0])/ips[0] : 0.0,errors);
+	else if (format==FORMAT_CSV)
+		ee_printf("layout,contexts,iterations_per_sec,crc_errors\nisolated,%u,%f,%u\npacked,%u,%f,%u\n",num,ips[0],errors,num,ips[1],errors);
+	else {
+		ee_printf("False sharing    : %u contexts, running crcs %u bytes, data %u bytes per context, %u byte lines\n",
+			num,(ee_u32)sizeof(core_crcs),(ee_u32)slice,MEMBLOCK_LINE_SIZE);
+		ee_printf("  isolated       : %f iterations/sec\n",ips[0]);
+		ee_printf("  packed         : %f iterations/sec (%+.2f%%)%s\n",ips[1],
+			(ips[0]>0) ? 100.0*(ips[1]-ips[0])/ips[0] : 0.0,errors ? " ERROR! crc mismatch" : "");
+		if (num<2)
+			ee_printf("  only one context, run with -threads=N to make contexts share lines\n");
+	}
+	portable_free(view);
+	portable_memblock_free(data);
+	portable_memblock_free(crcs);
+	portable_memblock_free(packed);
+	return errors;
+}
+
+/* Function: scale_curve
+	Run the first n contexts for every count n of <core_options.scale>, reusing their data,
+	and report aggregate and per context iterations/sec, and the parallel efficiency
+	relative to a single context, which is always measured first.
+	The crcs of every point are checked against the expected ones.
+
+	Returns:
+	Number of points with crc errors.
+*/
+static ee_u32 scale_curve(core_results **results, ee_u32 iterations, core_ref *expected) {
+	ee_u32 counts[MAX_SCALE_POINTS+1];
+	ee_u32 points=0,p,i,errors=0;
+	secs_ret one=0;
+	ee_u8 format=portable_options.format;
+	if (portable_options.scale[0]!=1)
+		counts[points++]=1;
+	for (p=0; p<portable_options.scale_points; p++)
+		counts[points++]=portable_options.scale[p];
+	if (format==FORMAT_TEXT) {
+		ee_printf("Scaling curve    : %u iterations per context, %s scheduling\n",iterations,
+			(portable_options.sched==SCHED_STEAL) ? "steal" : "static");
+		ee_printf("  %8s %16s %16s %11s %s\n","contexts","it/s total","it/s per ctx","efficiency","crcs");
+	} else if (format==FORMAT_CSV) {
+		ee_printf("contexts,iterations_per_sec,iterations_per_sec_per_context,efficiency_percent,crc_errors\n");
+	}
+	for (p=0; p<points; p++) {
+		ee_u32 n=counts[p];
+		ee_u32 total,bad=0;
+		secs_ret secs=time_in_secs(run_contexts(results,n,iterations,&total));
+		secs_ret ips=(secs>0) ? total/secs : 0;
+		secs_ret eff;
+		for (i=0; i<n; i++) {
+			if (((results[i]->execs & ID_LIST) && (results[i]->crclist!=expected->crclist)) ||
+				((results[i]->execs & ID_MATRIX) && (results[i]->crcmatrix!=expected->crcmatrix)) ||
+				((results[i]->execs & ID_STATE) && (results[i]->crcstate!=expected->crcstate)))
+				bad++;
+		}
+		if (bad)
+			errors++;
+		if (n==1)
+			one=ips;
+		eff=(one>0) ? 100.0*ips/(n*one) : 0;
+		if (format==FORMAT_JSON)
+			ee_printf("{\"contexts\":%u,\"iterations_per_sec\":%f,\"iterations_per_sec_per_context\":%f,\"efficiency_percent\":%f,\"crc_errors\":%u}\n",
+				n,ips,ips/n,eff,bad);
+		else if (format==FORMAT_CSV)
+			ee_printf("%u,%f,%f,%f,%u\n",n,ips,ips/n,eff,bad);
+		else
+			ee_printf("  %8u %16.3f %16.3f %10.1f%% %s\n",n,ips,ips/n,eff,bad ? "ERROR" : "ok");
+	}
+	return errors;
+}
+#endif
+
+/* Function: soak
+	Keep running the initialized contexts in windows of about <core_options.soak_window> ms,
+	until <core_options.soak> seconds have passed or <portable_soak_stop> returns non zero.
+
+	Every window reports iterations/sec and its deviation from the first window. When three windows
+	in a row are more than <core_options.soak_throttle> percent below the first one, a throttling
+	warning is printed. The crcs of every window are checked against the ones of the benchmark run,
+	and the trend is reported as the least squares slope of iterations/sec over time.
+
+	Returns:
+	Number of windows with crc errors.
+*/
+static ee_u32 soak(core_results **results, ee_u32 num, ee_u32 iterations, CORE_TICKS ticks) {
+	secs_ret window=portable_options.soak_window/1000.0;
+	secs_ret secs=time_in_secs(ticks),elapsed=0,first=0,min=0,max=0,ips,dev,mid;
+	secs_ret sum_t=0,sum_y=0,sum_tt=0,sum_ty=0,slope=0;
+	ee_u16 crclist=results[0]->crclist,crcmatrix=results[0]->crcmatrix,crcstate=results[0]->crcstate;
+	ee_u32 i,n=0,total,below=0,episodes=0,errors=0;
+	ee_u32 it=(secs>0) ? (ee_u32)(iterations*window/secs) : iterations;
+	ee_u8 format=portable_options.format;
+
+	if (it==0)
+		it=1;
+	if (format==FORMAT_TEXT)
+		ee_printf("Soak             : %u ms windows, warning at %u%% below the first window\n",
+			portable_options.soak_window,portable_options.soak_throttle);
+	else if (format==FORMAT_CSV)
+		ee_printf("soak_window,t,iterations,seconds,iterations_per_sec,delta_percent,crc_errors,throttled\n");
+	portable_soak_begin();
+	while ((portable_options.soak==SOAK_FOREVER) || (elapsed<portable_options.soak)) {
+		ee_u32 bad=0;
+		secs=time_in_secs(run_contexts(results,num,it,&total));
+		mid=elapsed+secs/2;
+		elapsed+=secs;
+		ips=(secs>0) ? total/secs : 0;
+		if (n==0)
+			first=min=max=ips;
+		if (ips<min)
+			min=ips;
+		if (ips>max)
+			max=ips;
+		dev=(first>0) ? 100.0*(ips-first)/first : 0;
+		sum_t+=mid;
+		sum_y+=ips;
+		sum_tt+=mid*mid;
+		sum_ty+=mid*ips;
+		for (i=0; i<num; i++) {
+			if (((results[i]->execs & ID_LIST) && (results[i]->crclist!=crclist)) ||
+				((results[i]->execs & ID_MATRIX) && (results[i]->crcmatrix!=crcmatrix)) ||
+				((results[i]->execs & ID_STATE) && (results[i]->crcstate!=crcstate)))
+				bad++;
+		}
+		if (bad)
+			errors++;
+		below=(dev<-(secs_ret)portable_options.soak_throttle) ? below+1 : 0;
+		if (below==3)
+			episodes++;
+		if (format==FORMAT_JSON)
+			ee_printf("{\"soak_window\":%u,\"t\":%f,\"iterations\":%u,\"seconds\":%f,\"iterations_per_sec\":%f,\"delta_percent\":%f,\"crc_errors\":%u,\"throttled\":%u}\n",
+				n,elapsed,total,secs,ips,dev,bad,(below>=3));
+		else if (format==FORMAT_CSV)
+			ee_printf("%u,%f,%u,%f,%f,%f,%u,%u\n",n,elapsed,total,secs,ips,dev,bad,(below>=3));
+		else {
+			ee_printf("Soak window %-5u: t=%9.1fs %14.3f it/s %+7.2f%%\n",n,elapsed,ips,dev);
+			if (bad)
+				ee_printf("ERROR! crc mismatch in %u contexts\n",bad);
+			if (below==3)
+				ee_printf("WARNING! Sustained throughput more than %u%% below the first window, the core may be throttling\n",
+					portable_options.soak_throttle);
+		}
+		n++;
+		/* aim the next window at the requested length */
+		if (secs>0) {
+			secs_ret scale=window/secs;
+			if (scale>2)
+				scale=2;
+			if (scale<0.5)
+				scale=0.5;
+			it=(ee_u32)(it*scale);
+			if (it==0)
+				it=1;
+		}
+		if (portable_soak_stop())
+			break;
+	}
+	portable_soak_end();
+	if ((n>1) && (n*sum_tt-sum_t*sum_t>0))
+		slope=(n*sum_ty-sum_t*sum_y)/(n*sum_tt-sum_t*sum_t);
+	if (format==FORMAT_JSON)
+		ee_printf("{\"soak_windows\":%u,\"seconds\":%f,\"first\":%f,\"min\":%f,\"max\":%f,\"mean\":%f,\"trend_percent_per_min\":%f,\"throttle_warnings\":%u,\"crc_error_windows\":%u}\n",
+			n,elapsed,first,min,max,n ? sum_y/n : 0.0,(first>0) ? 100.0*60*slope/first : 0.0,episodes,errors);
+	else if (format==FORMAT_TEXT) {
+		ee_printf("Soak windows     : %u in %.1f s\n",n,elapsed);
+		ee_printf("Soak it/s        : first %f min %f max %f mean %f\n",first,min,max,n ? sum_y/n : 0.0);
+		ee_printf("Soak trend       : %+.3f%% per minute\n",(first>0) ? 100.0*60*slope/first : 0.0);
+		ee_printf("Soak warnings    : %u throttling, %u windows with crc errors\n",episodes,errors);
+	}
+	return errors;
+}
+#endif
+
+#if HAS_FLOAT
+/* two sided 95% quantiles of Student's t distribution for 1..30 degrees of freedom */
+static const double t_quantile_95[30]={
+	12.706,4.303,3.182,2.776,2.571,2.447,2.365,2.306,2.262,2.228,
+	2.201,2.179,2.160,2.145,2.131,2.120,2.110,2.101,2.093,2.086,
+	2.080,2.074,2.069,2.064,2.060,2.056,2.052,2.048,2.045,2.042
+};
+static void sort_values(secs_ret *x, ee_u32 n) {
+	ee_u32 i,j;
+	for (i=1; i<n; i++) {
+		secs_ret v=x[i];
+		for (j=i; (j>0) && (x[j-1]>v); j--)
+			x[j]=x[j-1];
+		x[j]=v;
+	}
+}
+static secs_ret median_of_sorted(secs_ret *x, ee_u32 n) {
+	return (n&1) ? x[n/2] : (x[n/2-1]+x[n/2])/2;
+}
+/* Structure: trial_stats
+	Statistics of iterations/sec over the measured trials.
+*/
+typedef struct TRIAL_STATS_S {
+	ee_u32 trials;
+	ee_u32 warmup;
+	ee_u32 rejected;
+	secs_ret min;
+	secs_ret median;
+	secs_ret mean;
+	secs_ret stddev;
+	secs_ret ci;	/* half width of the 95% confidence interval of the mean */
+	secs_ret cv;	/* coefficient of variation in percent */
+} trial_stats;
+
+/* Function: compute_trials
+	Compute the statistics of iterations/sec over the measured trials.
+
+	Trials whose modified z-score (0.6745*|x-median|/MAD) is above 3.5 are rejected
+	as outliers before the mean, standard deviation, 95% confidence interval of the mean
+	and coefficient of variation are computed.
+
+	Returns:
+	0 if the scratch space cannot be allocated, st is not filled in then.
+*/
+static ee_u8 compute_trials(secs_ret *ips, ee_u32 n, ee_u32 warmup, trial_stats *st) {
+	secs_ret *x=(secs_ret *)portable_malloc(2*n*sizeof(secs_ret));
+	secs_ret *dev;
+	secs_ret med,mad,mean=0,var=0,sd,t;
+	ee_u32 i,kept=0;
+	if (x==NULL)
+		return 0;
+	dev=x+n;
+	for (i=0; i<n; i++)
+		x[i]=ips[i];
+	sort_values(x,n);
+	med=median_of_sorted(x,n);
+	for (i=0; i<n; i++)
+		dev[i]=fabs(x[i]-med);
+	sort_values(dev,n);
+	mad=median_of_sorted(dev,n);
+	for (i=0; i<n; i++) {
+		if ((mad>0) && (0.6745*fabs(x[i]-med)/mad>3.5))
+			continue;
+		x[kept++]=x[i];
+	}
+	for (i=0; i<kept; i++)
+		mean+=x[i];
+	mean/=kept;
+	for (i=0; i<kept; i++)
+		var+=(x[i]-mean)*(x[i]-mean);
+	sd=(kept>1) ? sqrt(var/(kept-1)) : 0;
+	t=(kept-1<=30) ? t_quantile_95[(kept>1) ? kept-2 : 0] : 1.96+2.372/(kept-1);
+	st->trials=n;
+	st->warmup=warmup;
+	st->rejected=n-kept;
+	st->min=x[0];
+	st->median=median_of_sorted(x,kept);
+	st->mean=mean;
+	st->stddev=sd;
+	st->ci=(kept>1) ? t*sd/sqrt((secs_ret)kept) : 0;
+	st->cv=(mean>0) ? 100*sd/mean : 0;
+	portable_free(x);
+	return 1;
+}
+#endif
+
+#if (COREMARK_ARDUINO==0)
+/* Function: print_json_string
+	Print a JSON string literal, escaping quotes, backslashes and control characters.
+*/
+static void print_json_string(const char *str) {
+	ee_printf("\"");
+	for (; *str; str++) {
+		if ((*str=='"') || (*str=='\\'))
+			ee_printf("\\%c",*str);
+		else if ((unsigned char)*str<0x20)
+			ee_printf("\\u%04x",(unsigned char)*str);
+		else
+			ee_printf("%c",*str);
+	}
+	ee_printf("\"");
+}
+/* Function: print_csv_string
+	Print a CSV field, quoted and with embedded quotes doubled.
+*/
+static void print_csv_string(const char *str) {
+	ee_printf("\"");
+	for (; *str; str++) {
+		if (*str=='"')
+			ee_printf("\"");
+		ee_printf("%c",*str);
+	}
+	ee_printf("\"");
+}
+/* Function: report_record
+	Report the run as one machine readable record, see <FORMAT_JSON> and <FORMAT_CSV>.
+
+	Per context crcs are JSON arrays, or ';' separated lists in CSV.
+	Trial statistics are only filled in when more than one trial was measured. iterations_per_sec is then
+	their median after outlier rejection, while iterations, ticks and seconds are those of the last trial.
+*/
+static void report_record(core_results **results, ee_u32 num, ee_u16 seedcrc, ee_s16 known_id, const char *validation, ee_s16 total_errors,
+		CORE_TICKS init_time, CORE_TICKS total_time, ee_u32 total_iterations, trial_stats *st) {
+	static const char *crc_names[4]={"crclist","crcmatrix","crcstate","crc"};
+	char cpu[128];
+	secs_ret secs=time_in_secs(total_time);
+	secs_ret ips=st ? st->median : ((secs>0) ? total_iterations/secs : 0.0);
+	ee_u32 i,k;
+	ee_u8 json=(portable_options.format==FORMAT_JSON);
+	portable_cpu_model(cpu,sizeof(cpu));
+	if (json) {
+		ee_printf("{\"size\":%u,\"seed1\":%d,\"seed2\":%d,\"seed3\":%d,\"iterations\":%u,\"ticks\":%lu,\"seconds\":%f,\"iterations_per_sec\":%f,\"init_seconds\":%f",
+			results[0]->size,results[0]->seed1,results[0]->seed2,results[0]->seed3,total_iterations,(unsigned long)total_time,
+			secs,ips,time_in_secs(init_time));
+		for (k=0; k<4; k++) {
+			ee_printf(",\"%s\":[",crc_names[k]);
+			for (i=0; i<num; i++) {
+				ee_u16 v=(k==0) ? results[i]->crclist : (k==1) ? results[i]->crcmatrix : (k==2) ? results[i]->crcstate : results[i]->crc;
+				ee_printf("%s\"0x%04x\"",i ? "," : "",v);
+			}
+			ee_printf("]");
+		}
+		ee_printf(",\"seedcrc\":\"0x%04x\",\"known_id\":%d,\"validation\":\"%s\",\"errors\":%d,\"compiler_version\":",seedcrc,known_id,validation,total_errors);
+		print_json_string(COMPILER_VERSION);
+		ee_printf(",\"compiler_flags\":");
+		print_json_string(COMPILER_FLAGS);
+		ee_printf(",\"mem_location\":");
+		print_json_string(MEM_LOCATION);
+		ee_printf(",\"mem_backend\":\"%s\",\"threads\":%u,\"timer\":\"%s\",\"matrix_kernels\":\"%s\",\"matrix_mul_kernels\":\"%s\",\"matrix_transposed\":%u,\"matrix_fused\":%u",
+			memblock_names[portable_memblock_used],num,portable_timer->name,matrix_kernels->name,matrix_mul_kernels_name(),matrix_transposed,matrix_fused);
+#if HAS_NUMA
+		ee_printf(",\"numa\":\"%s\",\"affinity\":\"%s\"",numa_names[portable_options.numa],affinity_names[portable_options.affinity]);
+		if (portable_options.numa==NUMA_BOTH)
+			ee_printf(",\"numa_remote_iterations_per_sec\":%f",numa_remote_ips);
+#endif
+		ee_printf(",\"cpu_model\":");
+		print_json_string(cpu);
+		if (st)
+			ee_printf(",\"trials\":{\"measured\":%u,\"warmup\":%u,\"rejected\":%u,\"min\":%f,\"median\":%f,\"mean\":%f,\"stddev\":%f,\"ci95\":%f,\"cv_percent\":%f}",
+				st->trials,st->warmup,st->rejected,st->min,st->median,st->mean,st->stddev,st->ci,st->cv);
+#if LATENCY_HIST
+		if (portable_options.latency) {
+			static const double q[5]={0.5,0.9,0.99,0.999,1.0};
+			static const char *qn[5]={"p50","p90","p99","p99_9","max"};
+			ee_printf(",\"latency_us\":[");
+			for (i=0; i<num; i++) {
+				ee_printf("%s{\"count\":%u",i ? "," : "",results[i]->lat.total);
+				for (k=0; k<5; k++)
+					ee_printf(",\"%s\":%f",qn[k],time_in_secs(latency_percentile(&(results[i]->lat),q[k]))*1e6);
+				ee_printf("}");
+			}
+			ee_printf("]");
+		}
+#endif
+		ee_printf("}\n");
+		return;
+	}
+	ee_printf("size,seed1,seed2,seed3,iterations,ticks,seconds,iterations_per_sec,init_seconds,crclist,crcmatrix,crcstate,crc,seedcrc,known_id,validation,errors,"
+		"compiler_version,compiler_flags,mem_location,mem_backend,threads,timer,matrix_kernels,matrix_mul_kernels,matrix_transposed,matrix_fused,cpu_model,"
+		"trials,warmup,rejected,ips_min,ips_median,ips_mean,ips_stddev,ips_ci95,ips_cv_percent\n");
+	ee_printf("%u,%d,%d,%d,%u,%lu,%f,%f,%f",results[0]->size,results[0]->seed1,results[0]->seed2,results[0]->seed3,
+		total_iterations,(unsigned long)total_time,secs,ips,time_in_secs(init_time));
+	for (k=0; k<4; k++) {
+		ee_printf(",");
+		for (i=0; i<num; i++) {
+			ee_u16 v=(k==0) ? results[i]->crclist : (k==1) ? results[i]->crcmatrix : (k==2) ? results[i]->crcstate : results[i]->crc;
+			ee_printf("%s0x%04x",i ? ";" : "",v);
+		}
+	}
+	ee_printf(",0x%04x,%d,%s,%d,",seedcrc,known_id,validation,total_errors);
+	print_csv_string(COMPILER_VERSION);
+	ee_printf(",");
+	print_csv_string(COMPILER_FLAGS);
+	ee_printf(",");
+	print_csv_string(MEM_LOCATION);
+	ee_printf(",%s,%u,%s,%s,%s,%u,%u,",memblock_names[portable_memblock_used],num,portable_timer->name,matrix_kernels->name,matrix_mul_kernels_name(),
+		matrix_transposed,matrix_fused);
+	print_csv_string(cpu);
+	if (st)
+		ee_printf(",%u,%u,%u,%f,%f,%f,%f,%f,%f\n",st->trials,st->warmup,st->rejected,
+			st->min,st->median,st->mean,st->stddev,st->ci,st->cv);
+	else
+		ee_printf(",1,%u,0,,,,,,\n",portable_options.warmup);
 }
+#endif
+
+#if HAS_PERF_EVENTS
+/* Function: perf_kernels
+	Count each kernel in isolation on one context, after the timed run.
+
+	The list kernel is run without the sort that calls the other kernels,
+	the state and matrix kernels are called directly as <calc_func> would.
+*/
+static void perf_kernels(core_results *res, core_perf *p, ee_u32 reps) {
+	volatile ee_u16 sink=0;
+	ee_u32 i;
+	if (res->execs & ID_LIST) {
+		portable_perf_start(p);
+		for (i=0; i<reps; i++)
+			sink+=core_bench_list(res,-1);
+		portable_perf_stop(p);
+		portable_perf_report(p,"  list per call",reps);
+	}
+	if (res->execs & ID_STATE) {
+		portable_perf_start(p);
+		for (i=0; i<reps; i++)
+			sink+=core_bench_state(res->size,res->memblock[3],res->seed1,res->seed2,0x22+(i&0x7)*0x11,0);
+		portable_perf_stop(p);
+		portable_perf_report(p,"  state per call",reps);
+	}
+	if (res->execs & ID_MATRIX) {
+		portable_perf_start(p);
+		for (i=0; i<reps; i++)
+			sink+=core_bench_matrix(&(res->mat),(ee_s16)((i&0xf)*0x11),0);
+		portable_perf_stop(p);
+		portable_perf_report(p,"  matrix per call",reps);
+	}
+}
+#endif
 
 #if (SEED_METHOD==SEED_ARG)
 ee_s32 get_seed_args(int i, int argc, char *argv[]);
@@ -1250,6 +4504,12 @@ char *mem_name[3] = {"Static","Heap","Stack"};
 	2 - second seed : Must be identical to first for iterations to be identical
 	3 - third seed  : Any value, should be at least an order of magnitude less then the input size, but bigger then 32.
 	4 - Iterations  : Special, if set to 0, iterations will be automatically determined such that the benchmark will run between 10 to 100 secs
+	5 - Execs       : Bitmask of the algorithms to run, see <ID_LIST>, 0 for all.
+	6 - Unused
+	7 - Data size   : Total bytes of data per context, K and M suffixes allowed, see <parseval>. 0 for <TOTAL_DATA_SIZE>.
+
+	Arguments are read with <SEED_ARG>, the default on a host. Leading -name=value arguments are
+	port options (thread count, output format...), see <portable_init>.
 
 */
 
@@ -1262,252 +4522,414 @@ MAIN_RETURN_TYPE coremark_main(int argc, char *argv[]) {
 #endif*/
 
 //----------------------------LT--------------------------------//
+#if (COREMARK_ARDUINO==1)
 int coremark_main(void) {
 	int argc=0;
 	char *argv[1];
-	ee_u16 i,j=0,num_algorithms=0;
+#else
+int coremark_main(int argc, char *argv[]) {
+#endif
+	ee_u16 i,num_algorithms=0;
 	ee_s16 known_id=-1,total_errors=0;
+	ee_u32 after_errors=0;
 	ee_u16 seedcrc=0;
-	CORE_TICKS total_time;
-	core_results results[MULTITHREAD];
+	CORE_TICKS total_time=0,init_time=0;
+	ee_u32 iterations,total_iterations=0,measured_iterations=0;
+	core_portable main_port;
+	ee_u8 text;
+	core_ref expected;
+	const char *validation="none";
+#if HAS_FLOAT
+	secs_ret *trial_ips=NULL;
+	trial_stats stats={0,0,0,0,0,0,0,0,0};
+	ee_u8 have_stats=0;
+#endif
+#if HAS_PERF_EVENTS
+	core_perf perf;
+	ee_u8 perf_ok=0;
+#endif
+#if USE_PTHREAD
+	core_results **results;
+#else
+	core_results ctx_results[MULTITHREAD];
+	core_results *results[MULTITHREAD];
+#endif
 #if (MEM_METHOD==MEM_STACK)
 	ee_u8 stack_memblock[TOTAL_DATA_SIZE*MULTITHREAD];
 #endif
 
 	/* first call any initializations needed */
-	//--LT--// portable_init(&(results[0].port), &argc, argv);
+	portable_init(&main_port, &argc, argv);
+	text=(portable_options.format==FORMAT_TEXT);
+	matrix_blocking_init();
 	/* First some checks to make sure benchmark will run ok */
 	if (sizeof(struct list_head_s)>128) {
 		ee_printf("list_head structure too big for comparable data!\n");
 		return MAIN_RETURN_VAL;
 	}
-	/*results[0].seed1=get_seed(1);
-	results[0].seed2=get_seed(2);
-	results[0].seed3=get_seed(3);
-	results[0].iterations=get_seed_32(4);*/
+	/* each context gets its own results structure */
+#if USE_PTHREAD
+	results=(core_results **)portable_malloc(default_num_contexts*sizeof(core_results *));
+	/* every context on its own cache lines, so that their outputs do not falsely share */
+	for (i=0 ; i<default_num_contexts; i++)
+		results[i]=(core_results *)portable_memblock_alloc_with(MEMBLOCK_LINE,sizeof(core_results));
+#else
+	for (i=0 ; i<MULTITHREAD; i++)
+		results[i]=&ctx_results[i];
+#endif
+	for (i=0 ; i<default_num_contexts; i++)
+		memset(results[i],0,sizeof(core_results));
+#if HAS_NUMA
+	for (i=0 ; i<default_num_contexts; i++) {
+		results[i]->port.cpu=-1;
+		results[i]->port.node=-1;
+	}
+	if ((portable_options.affinity!=AFFINITY_NONE) && (portable_options.affinity!=AFFINITY_ALL) &&
+		!affinity_place(results,default_num_contexts,portable_options.affinity))
+		ee_errorf("ERROR! No cpus for affinity %s, contexts are not pinned\n",affinity_names[portable_options.affinity]);
+#endif
+	results[0]->seed1=get_seed(1);
+	results[0]->seed2=get_seed(2);
+	results[0]->seed3=get_seed(3);
+	results[0]->iterations=get_seed_32(4);
 #if CORE_DEBUG
-	results[0].iterations=1;
+	results[0]->iterations=1;
 #endif
-	//results[0].execs=get_seed_32(5);
-	if (results[0].execs==0) { /* if not supplied, execute all algorithms */
-		results[0].execs=ALL_ALGORITHMS_MASK;
+	results[0]->execs=get_seed_32(5);
+	if (results[0]->execs==0) { /* if not supplied, execute all algorithms */
+		results[0]->execs=ALL_ALGORITHMS_MASK;
 	}
 	/* put in some default values based on one seed only for easy testing */
-	if ((results[0].seed1==0) && (results[0].seed2==0) && (results[0].seed3==0)) { /* validation run */
-		results[0].seed1=0;
-		results[0].seed2=0;
-		results[0].seed3=0x66;
+	if ((results[0]->seed1==0) && (results[0]->seed2==0) && (results[0]->seed3==0)) { /* validation run */
+		results[0]->seed1=0;
+		results[0]->seed2=0;
+		results[0]->seed3=0x66;
+	}
+	if ((results[0]->seed1==1) && (results[0]->seed2==0) && (results[0]->seed3==0)) { /* perfromance run */
+		results[0]->seed1=0x3415;
+		results[0]->seed2=0x3415;
+		results[0]->seed3=0x66;
+	}
+#if HAS_FLOAT
+	if (portable_options.sweep_min) {
+		size_sweep(results[0]);
+#if USE_PTHREAD
+		for (i=0 ; i<default_num_contexts; i++)
+			portable_memblock_free(results[i]);
+		portable_free(results);
+#endif
+		portable_fini(&main_port);
+		return MAIN_RETURN_VAL;
 	}
-	if ((results[0].seed1==1) && (results[0].seed2==0) && (results[0].seed3==0)) { /* perfromance run */
-		results[0].seed1=0x3415;
-		results[0].seed2=0x3415;
-		results[0].seed3=0x66;
+#endif
+	for (i=0; i<NUM_ALGORITHMS; i++) {
+		if ((1<<(ee_u32)i) & results[0]->execs)
+		num_algorithms++;
 	}
 #if (MEM_METHOD==MEM_STATIC)
-	results[0].memblock[0]=(void *)static_memblk;
-	results[0].size=TOTAL_DATA_SIZE;
-	results[0].err=0;
+	matrix_transposed=0; /* no room for the transposed copy */
+	results[0]->memblock[0]=static_memblk;
+	results[0]->size=TOTAL_DATA_SIZE;
+	results[0]->err=0;
 #if (MULTITHREAD>1)
 #error "Cannot use a static data area with multiple contexts!"
 #endif
 #elif (MEM_METHOD==MEM_MALLOC)
-	for (i=0 ; i<MULTITHREAD; i++) {
-		ee_s32 malloc_override=get_seed(7);
-		if (malloc_override != 0)
-		results[i].size=malloc_override;
+#if HAS_NUMA
+	/* mbind works on whole pages, keep contexts from sharing them */
+	if ((portable_options.numa!=NUMA_OFF) && (portable_options.mem<MEMBLOCK_PAGE))
+		portable_options.mem=MEMBLOCK_PAGE;
+#endif
+	for (i=0 ; i<default_num_contexts; i++) {
+		ee_s32 malloc_override=get_seed_32(7);
+		if (malloc_override > 0)
+		results[i]->size=malloc_override;
 		else
-		results[i].size=TOTAL_DATA_SIZE;
-		results[i].memblock[0]=portable_malloc(results[i].size);
-		results[i].seed1=results[0].seed1;
-		results[i].seed2=results[0].seed2;
-		results[i].seed3=results[0].seed3;
-		results[i].err=0;
-		results[i].execs=results[0].execs;
+		results[i]->size=TOTAL_DATA_SIZE;
+		results[i]->memblock[0]=(ee_u8 *)portable_memblock_alloc(results[i]->size+matrix_transposed_space(results[i]->size/num_algorithms));
+#if HAS_NUMA
+		if (portable_options.numa!=NUMA_OFF)
+			numa_place(results[i],i,(portable_options.numa==NUMA_REMOTE),0);
+#endif
+		results[i]->seed1=results[0]->seed1;
+		results[i]->seed2=results[0]->seed2;
+		results[i]->seed3=results[0]->seed3;
+		results[i]->err=0;
+		results[i]->execs=results[0]->execs;
 	}
 #elif (MEM_METHOD==MEM_STACK)
-	for (i=0 ; i<MULTITHREAD; i++) {
-		results[i].memblock[0]=stack_memblock+i*TOTAL_DATA_SIZE;
-		results[i].size=TOTAL_DATA_SIZE;
-		results[i].seed1=results[0].seed1;
-		results[i].seed2=results[0].seed2;
-		results[i].seed3=results[0].seed3;
-		results[i].err=0;
-		results[i].execs=results[0].execs;
+#if USE_PTHREAD
+#error "Cannot use a stack data area when the number of contexts is chosen at run time!"
+#endif
+	matrix_transposed=0; /* no room for the transposed copy */
+	for (i=0 ; i<default_num_contexts; i++) {
+		results[i]->memblock[0]=stack_memblock+i*TOTAL_DATA_SIZE;
+		results[i]->size=TOTAL_DATA_SIZE;
+		results[i]->seed1=results[0]->seed1;
+		results[i]->seed2=results[0]->seed2;
+		results[i]->seed3=results[0]->seed3;
+		results[i]->err=0;
+		results[i]->execs=results[0]->execs;
 	}
 #else
 #error "Please define a way to initialize a memory block."
 #endif
 	/* Data init */
 	/* Find out how space much we have based on number of algorithms */
-	for (i=0; i<NUM_ALGORITHMS; i++) {
-		if ((1<<(ee_u32)i) & results[0].execs)
-		num_algorithms++;
-	}
-	for (i=0 ; i<MULTITHREAD; i++)
-	results[i].size=results[i].size/num_algorithms;
-	/* Assign pointers */
-	for (i=0; i<NUM_ALGORITHMS; i++) {
-		ee_u32 ctx;
-		if ((1<<(ee_u32)i) & results[0].execs) {
-			for (ctx=0 ; ctx<MULTITHREAD; ctx++)
-			//results[ctx].memblock[i+1]=(char *)(results[ctx].memblock[0])+results[0].size*j; //--LT--//
-			results[ctx].memblock[i+1]=(ee_u8 *)(results[ctx].memblock[0])+results[0].size*j;
-			j++;
-		}
-	}
-	/* call inits */
-	/*for (i=0 ; i<MULTITHREAD; i++) {
-		if (results[i].execs & ID_LIST) {
-			results[i].list=core_list_init(results[0].size,results[i].memblock[1],results[i].seed1);
-		}
-		if (results[i].execs & ID_MATRIX) {
-			core_init_matrix(results[0].size, results[i].memblock[2], (ee_s32)results[i].seed1 | (((ee_s32)results[i].seed2) << 16), &(results[i].mat) );
-		}
-		if (results[i].execs & ID_STATE) {
-			core_init_state(results[0].size,results[i].seed1,results[i].memblock[3]);
-		}
-	}*/
+	for (i=0 ; i<default_num_contexts; i++)
+	results[i]->size=results[i]->size/num_algorithms;
+	/* call inits, timed separately from the benchmark */
+	init_time=init_contexts(results,default_num_contexts);
 	/* automatically determine number of iterations if not set */
-	if (results[0].iterations==0) {
+	if (results[0]->iterations==0) {
 		secs_ret secs_passed=0;
 		ee_u32 divisor;
-		results[0].iterations=1;
+		results[0]->iterations=1;
 		while (secs_passed < (secs_ret)1) {
-			results[0].iterations*=10;
-			//--LT--// start_time();
-			iterate(&results[0]);
-			//--LT--// stop_time();
-			//--LT--// secs_passed=time_in_secs(get_time());
+			results[0]->iterations*=10;
+			start_time();
+			iterate(results[0]);
+			stop_time();
+			secs_passed=time_in_secs(get_time());
 		}
 		/* now we know it executes for at least 1 sec, set actual run time at about 10 secs */
 		divisor=(ee_u32)secs_passed;
 		if (divisor==0) /* some machines cast float to int as 0 since this conversion is not defined by ANSI, but we know at least one second passed */
 		divisor=1;
-		results[0].iterations*=1+10/divisor;
+		results[0]->iterations*=1+10/divisor;
 	}
 
 	/* perform actual benchmark */
-	//--LT--// start_time();
-	int cm_start;
-	//cm_start = millis();
-
 #if (MULTITHREAD>1)
 	if (default_num_contexts>MULTITHREAD) {
 		default_num_contexts=MULTITHREAD;
 	}
-	for (i=0 ; i<default_num_contexts; i++) {
-		results[i].iterations=results[0].iterations;
-		results[i].execs=results[0].execs;
-		core_start_parallel(&results[i]);
+#endif
+	iterations=results[0]->iterations;
+	for (i=0 ; i<portable_options.warmup; i++)
+		run_contexts(results,default_num_contexts,iterations,&total_iterations);
+#if HAS_FLOAT
+	if (portable_options.trials>1)
+		trial_ips=(secs_ret *)portable_malloc(portable_options.trials*sizeof(secs_ret));
+#endif
+#if HAS_PERF_EVENTS
+	if (portable_options.perf)
+		perf_ok=portable_perf_open(&perf);
+	if (perf_ok)
+		portable_perf_start(&perf);
+#endif
+	for (i=0 ; i<portable_options.trials; i++) {
+		total_time=run_contexts(results,default_num_contexts,iterations,&total_iterations);
+		measured_iterations+=total_iterations;
+#if HAS_FLOAT
+		if (trial_ips)
+			trial_ips[i]=(time_in_secs(total_time)>0) ? total_iterations/time_in_secs(total_time) : 0;
+#endif
 	}
-	for (i=0 ; i<default_num_contexts; i++) {
-		core_stop_parallel(&results[i]);
+#if HAS_PERF_EVENTS
+	if (perf_ok)
+		portable_perf_stop(&perf);
+#endif
+#if HAS_NUMA
+	if (portable_options.numa==NUMA_BOTH) {
+		ee_u32 remote_iterations;
+		secs_ret secs;
+		for (i=0 ; i<default_num_contexts; i++)
+			numa_place(results[i],i,1,1);
+		secs=time_in_secs(run_contexts(results,default_num_contexts,iterations,&remote_iterations));
+		numa_remote_ips=(secs>0) ? remote_iterations/secs : 0;
 	}
-#else
-	iterate(&results[0]);
-#endif
-	//--LT--// stop_time();
-	int cm_stop;
-	//cm_stop = millis();
-	int cm_total_time;
-	//cm_total_time = cm_stop - cm_start;
-	//--LT--// total_time=get_time();
+#endif
 	/* get a function of the input to report */
-	/*seedcrc=crc16(results[0].seed1,seedcrc);
-	seedcrc=crc16(results[0].seed2,seedcrc);
-	seedcrc=crc16(results[0].seed3,seedcrc);
-	seedcrc=crc16(results[0].size,seedcrc);*/
+	seedcrc=crc16(results[0]->seed1,seedcrc);
+	seedcrc=crc16(results[0]->seed2,seedcrc);
+	seedcrc=crc16(results[0]->seed3,seedcrc);
+	seedcrc=crc16(results[0]->size,seedcrc);
 
 	switch (seedcrc) { /* test known output for common seeds */
 		case 0x8a02: /* seed1=0, seed2=0, seed3=0x66, size 2000 per algorithm */
 		known_id=0;
-		ee_printf("6k performance run parameters for coremark.\n");
+		if (text) ee_printf("6k performance run parameters for coremark.\n");
 		break;
 		case 0x7b05: /*  seed1=0x3415, seed2=0x3415, seed3=0x66, size 2000 per algorithm */
 		known_id=1;
-		ee_printf("6k validation run parameters for coremark.\n");
+		if (text) ee_printf("6k validation run parameters for coremark.\n");
 		break;
 		case 0x4eaf: /* seed1=0x8, seed2=0x8, seed3=0x8, size 400 per algorithm */
 		known_id=2;
-		ee_printf("Profile generation run parameters for coremark.\n");
+		if (text) ee_printf("Profile generation run parameters for coremark.\n");
 		break;
 		case 0xe9f5: /* seed1=0, seed2=0, seed3=0x66, size 666 per algorithm */
 		known_id=3;
-		ee_printf("2K performance run parameters for coremark.\n");
+		if (text) ee_printf("2K performance run parameters for coremark.\n");
 		break;
 		case 0x18f2: /*  seed1=0x3415, seed2=0x3415, seed3=0x66, size 666 per algorithm */
 		known_id=4;
-		ee_printf("2K validation run parameters for coremark.\n");
+		if (text) ee_printf("2K validation run parameters for coremark.\n");
 		break;
 		default:
-		total_errors=-1;
+		/* no known crcs for these parameters, compute them */
+		expected.seed1=results[0]->seed1;
+		expected.seed2=results[0]->seed2;
+		expected.seed3=results[0]->seed3;
+		expected.size=results[0]->size;
+		expected.execs=results[0]->execs;
+		validation=reference_crcs(&expected) ? "cached reference" : "reference";
+		if (text) ee_printf("Run parameters validated against %s crcs for coremark.\n",validation);
 		break;
 	}
 	if (known_id>=0) {
-		for (i=0 ; i<default_num_contexts; i++) {
-			results[i].err=0;
-			if ((results[i].execs & ID_LIST) &&
-			(results[i].crclist!=list_known_crc[known_id])) {
-				ee_printf("[%u]ERROR! list crc 0x%04x - should be 0x%04x\n",i,results[i].crclist,list_known_crc[known_id]);
-				results[i].err++;
-			}
-			if ((results[i].execs & ID_MATRIX) &&
-			(results[i].crcmatrix!=matrix_known_crc[known_id])) {
-				ee_printf("[%u]ERROR! matrix crc 0x%04x - should be 0x%04x\n",i,results[i].crcmatrix,matrix_known_crc[known_id]);
-				results[i].err++;
-			}
-			if ((results[i].execs & ID_STATE) &&
-			(results[i].crcstate!=state_known_crc[known_id])) {
-				ee_printf("[%u]ERROR! state crc 0x%04x - should be 0x%04x\n",i,results[i].crcstate,state_known_crc[known_id]);
-				results[i].err++;
-			}
-			total_errors+=results[i].err;
+		validation="known";
+		expected.crclist=list_known_crc[known_id];
+		expected.crcmatrix=matrix_known_crc[known_id];
+		expected.crcstate=state_known_crc[known_id];
+	}
+	for (i=0 ; i<default_num_contexts; i++) {
+		results[i]->err=0;
+		if ((results[i]->execs & ID_LIST) &&
+		(results[i]->crclist!=expected.crclist)) {
+			if (text) ee_printf("[%u]ERROR! list crc 0x%04x - should be 0x%04x\n",i,results[i]->crclist,expected.crclist);
+			results[i]->err++;
+		}
+		if ((results[i]->execs & ID_MATRIX) &&
+		(results[i]->crcmatrix!=expected.crcmatrix)) {
+			if (text) ee_printf("[%u]ERROR! matrix crc 0x%04x - should be 0x%04x\n",i,results[i]->crcmatrix,expected.crcmatrix);
+			results[i]->err++;
 		}
+		if ((results[i]->execs & ID_STATE) &&
+		(results[i]->crcstate!=expected.crcstate)) {
+			if (text) ee_printf("[%u]ERROR! state crc 0x%04x - should be 0x%04x\n",i,results[i]->crcstate,expected.crcstate);
+			results[i]->err++;
+		}
+		total_errors+=results[i]->err;
 	}
 	//total_errors+=check_data_types();
+#if HAS_FLOAT
+	if (trial_ips) {
+		have_stats=compute_trials(trial_ips,portable_options.trials,portable_options.warmup,&stats);
+		portable_free(trial_ips);
+	}
+#endif
+	if (time_in_secs(total_time) < 10)
+		total_errors++;
+#if (COREMARK_ARDUINO==0)
+	if (!text) {
+		report_record(results,default_num_contexts,seedcrc,known_id,validation,total_errors,init_time,total_time,total_iterations,
+			have_stats ? &stats : NULL);
+#if HAS_PERF_EVENTS
+		if (perf_ok)
+			portable_perf_close(&perf);
+#endif
+	} else {
+#endif
 	/* and report results */
-/*********************************** LT *********************************************
-	ee_printf("CoreMark Size    : %lu\n",(ee_u32)results[0].size);
-	ee_printf("Total ticks      : %lu\n",(ee_u32)total_time);
+	ee_printf("CoreMark Size    : %u\n",(ee_u32)results[0]->size);
+	ee_printf("Total ticks      : %lu\n",(unsigned long)total_time);
 	#if HAS_FLOAT
 	ee_printf("Total time (secs): %f\n",time_in_secs(total_time));
-	if (time_in_secs(total_time) > 0)
-	ee_printf("Iterations/Sec   : %f\n",default_num_contexts*results[0].iterations/time_in_secs(total_time));
+	if (have_stats)
+	ee_printf("Iterations/Sec   : %f (median of the measured trials)\n",stats.median);
+	else if (time_in_secs(total_time) > 0)
+	ee_printf("Iterations/Sec   : %f\n",total_iterations/time_in_secs(total_time));
 	#else
 	ee_printf("Total time (secs): %d\n",time_in_secs(total_time));
 	if (time_in_secs(total_time) > 0)
-	ee_printf("Iterations/Sec   : %d\n",default_num_contexts*results[0].iterations/time_in_secs(total_time));
+	ee_printf("Iterations/Sec   : %d\n",total_iterations/time_in_secs(total_time));
 	#endif
+	ee_printf("Timer            : %s (%lu ticks/sec)\n",portable_timer->name,(unsigned long)portable_timer->ticks_per_sec);
+	ee_printf("Matrix kernels   : %s%s%s%s%s\n",matrix_kernels->name,(matrix_transposed || matrix_fused) ? ", multiplies " : "",
+		(matrix_transposed || matrix_fused) ? matrix_mul_kernels_name() : "",matrix_transposed ? " with transposed B" : "",
+		matrix_fused ? (matrix_transposed ? ", fused with the sums" : " fused with the sums") : "");
+#if HAS_FLOAT
+	ee_printf("Init time (secs) : %f (%u contexts, %s%s)\n",time_in_secs(init_time),default_num_contexts,USE_PTHREAD ? "in parallel" : "serial",
+		results[0]->snapshot ? ", from snapshot" : "");
+#else
+	ee_printf("Init time (secs) : %d\n",time_in_secs(init_time));
+#endif
+#if HAS_FLOAT
+	if (have_stats) {
+		ee_printf("Trials           : %u measured, %u warmup, %u outliers rejected\n",stats.trials,stats.warmup,stats.rejected);
+		ee_printf("Iterations/Sec   : min %f median %f mean %f\n",stats.min,stats.median,stats.mean);
+		ee_printf("                   stddev %f 95%% CI [%f, %f] CV %.2f%%\n",stats.stddev,stats.mean-stats.ci,stats.mean+stats.ci,stats.cv);
+	}
+#endif
+#if HAS_PERF_EVENTS
+	if (perf_ok)
+		portable_perf_report(&perf,"Perf per iter",measured_iterations);
+#endif
 	if (time_in_secs(total_time) < 10) {
 		ee_printf("ERROR! Must execute for at least 10 secs for a valid result!\n");
-		total_errors++;
 	}
-	ee_printf("Iterations       : %lu\n",(ee_u32)default_num_contexts*results[0].iterations);
+	ee_printf("Iterations       : %u\n",total_iterations);
 	ee_printf("Compiler version : %s\n",COMPILER_VERSION);
 	ee_printf("Compiler flags   : %s\n",COMPILER_FLAGS);
 #if (MULTITHREAD>1)
 	ee_printf("Parallel %s : %d\n",PARALLEL_METHOD,default_num_contexts);
+#endif
+#if USE_PTHREAD
+	if (portable_options.sched==SCHED_STEAL)
+	for (i=0 ; i<default_num_contexts; i++)
+	ee_printf("[%d]iterations    : %u (%u chunks stolen)\n",i,results[i]->iterations,results[i]->port.steals);
 #endif
 	ee_printf("Memory location  : %s\n",MEM_LOCATION);
+#if (MEM_METHOD==MEM_MALLOC)
+	ee_printf("Memory backend   : %s",memblock_names[portable_memblock_used]);
+	if (portable_memblock_used!=portable_options.mem)
+		ee_printf(" (%s not available)",memblock_names[portable_options.mem]);
+	ee_printf("\n");
+#endif
+#if HAS_NUMA
+	if ((portable_options.affinity!=AFFINITY_NONE) && (portable_options.affinity!=AFFINITY_ALL)) {
+		ee_printf("Affinity         : %s\n",affinity_names[portable_options.affinity]);
+		if (portable_options.numa==NUMA_OFF)
+		for (i=0 ; i<default_num_contexts; i++)
+		ee_printf("[%d]placement     : cpu %d\n",i,results[i]->port.cpu);
+	}
+	if (portable_options.numa!=NUMA_OFF) {
+		for (i=0 ; i<default_num_contexts; i++)
+		ee_printf("[%d]placement     : cpu %d, memory on node %d\n",i,results[i]->port.cpu,results[i]->port.node);
+		if ((portable_options.numa==NUMA_BOTH) && (time_in_secs(total_time)>0)) {
+			secs_ret local_ips=total_iterations/time_in_secs(total_time);
+			ee_printf("NUMA local       : %f iterations/sec\n",local_ips);
+			ee_printf("NUMA remote      : %f iterations/sec (%+.2f%%)\n",numa_remote_ips,
+				(local_ips>0) ? 100.0*(numa_remote_ips-local_ips)/local_ips : 0.0);
+			if (portable_numa_nodes()<2)
+				ee_printf("NUMA nodes       : 1, remote placement is the same node as local\n");
+		}
+	}
+#endif
 	// output for verification
 	ee_printf("seedcrc          : 0x%04x\n",seedcrc);
-	if (results[0].execs & ID_LIST)
+	if (results[0]->execs & ID_LIST)
 	for (i=0 ; i<default_num_contexts; i++)
-	ee_printf("[%d]crclist       : 0x%04x\n",i,results[i].crclist);
-	if (results[0].execs & ID_MATRIX)
+	ee_printf("[%d]crclist       : 0x%04x\n",i,results[i]->crclist);
+	if (results[0]->execs & ID_MATRIX)
 	for (i=0 ; i<default_num_contexts; i++)
-	ee_printf("[%d]crcmatrix     : 0x%04x\n",i,results[i].crcmatrix);
-	if (results[0].execs & ID_STATE)
+	ee_printf("[%d]crcmatrix     : 0x%04x\n",i,results[i]->crcmatrix);
+	if (results[0]->execs & ID_STATE)
 	for (i=0 ; i<default_num_contexts; i++)
-	ee_printf("[%d]crcstate      : 0x%04x\n",i,results[i].crcstate);
+	ee_printf("[%d]crcstate      : 0x%04x\n",i,results[i]->crcstate);
 	for (i=0 ; i<default_num_contexts; i++)
-	ee_printf("[%d]crcfinal      : 0x%04x\n",i,results[i].crc);
-*********************************************************************************/
+	ee_printf("[%d]crcfinal      : 0x%04x\n",i,results[i]->crc);
+#if KERNEL_PROFILE
+	kprof_report(results,default_num_contexts);
+#endif
+#if LATENCY_HIST
+	if (portable_options.latency)
+		latency_report(results,default_num_contexts);
+#endif
+#if HAS_PERF_EVENTS
+	if (perf_ok) {
+		ee_printf("Perf per kernel (context 0, in isolation)\n");
+		perf_kernels(results[0],&perf,results[0]->iterations);
+		portable_perf_close(&perf);
+	}
+#endif
 	if (total_errors==0) {
 		ee_printf("Correct operation validated. See readme.txt for run and reporting rules.\n");
 #if HAS_FLOAT
 		if (known_id==3) {
-			//--LT--//ee_printf("CoreMark 1.0 : %f / %s %s",default_num_contexts*results[0].iterations/time_in_secs(total_time),COMPILER_VERSION,COMPILER_FLAGS);
+			ee_printf("CoreMark 1.0 : %f / %s %s",have_stats ? stats.median : total_iterations/time_in_secs(total_time),COMPILER_VERSION,COMPILER_FLAGS);
 #if defined(MEM_LOCATION) && !defined(MEM_LOCATION_UNSPEC)
 			ee_printf(" / %s",MEM_LOCATION);
 #else
@@ -1525,15 +4947,55 @@ int coremark_main(void) {
 	ee_printf("Errors detected\n");
 	if (total_errors<0)
 	ee_printf("Cannot validate operation for these seed values, please compare with results on a known platform.\n");
+#if (COREMARK_ARDUINO==0)
+	}
+#endif
+#if HAS_FLOAT && HAS_NUMA
+	if (portable_options.affinity==AFFINITY_ALL)
+		affinity_compare(results,default_num_contexts,iterations,&expected);
+	if (portable_options.percpu)
+		percpu_scores(results,iterations,&expected);
+#endif
+#if HAS_FLOAT && USE_PTHREAD
+	if (portable_options.falseshare)
+		after_errors+=false_sharing_probe(results,default_num_contexts,iterations,&expected);
+	if (portable_options.scale_points)
+		scale_curve(results,iterations,&expected);
+#endif
+#if HAS_FLOAT
+	if (portable_options.matcompare)
+		after_errors+=matrix_compare(results[0]);
+	if (portable_options.soak)
+		after_errors+=soak(results,default_num_contexts,iterations,total_time);
+#endif
+	if (after_errors) {
+		total_errors=((total_errors>0) ? total_errors : 0)+(ee_s16)after_errors;
+		if (text)
+			ee_printf("Errors detected after the run\n");
+	}
 
 	#if (MEM_METHOD==MEM_MALLOC)
-	for (i=0 ; i<MULTITHREAD; i++)
-	portable_free(results[i].memblock[0]);
+	for (i=0 ; i<default_num_contexts; i++)
+	portable_memblock_free(results[i]->memblock[0]);
+	#endif
+	#if USE_PTHREAD
+	for (i=0 ; i<default_num_contexts; i++)
+	portable_memblock_free(results[i]);
+	portable_free(results);
 	#endif
 	/* And last call any target specific code for finalizing */
-	//--LT--//portable_fini(&(results[0].port));
+	portable_fini(&main_port);
 
-	return cm_total_time;	
+#if (COREMARK_ARDUINO==1)
+	/* the sketch gets the run time in milliseconds */
+	return (int)(time_in_secs(total_time)*1000);
+#else
+#if !MAIN_HAS_NORETURN
+	if (total_errors>0)
+		return 1;
+#endif
+	return MAIN_RETURN_VAL;
+#endif
 }
 //------------------------------------------------------------core_main.c-------------------------------------------------//
 
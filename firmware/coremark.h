@@ -26,10 +26,26 @@ El Dorado Hills, CA, 95762
 //----------------------------LT--------------------------------//
 //#ifndef SPARK_COREMAK_H
 //#define SPARK_COREMARK_H
-//#include <stdio.h>
-//#include <stdlib.h>
-//#include <string.h>
+/* Configuration : COREMARK_ARDUINO
+	Define to 1 to build for the Spark firmware (default).
+	Define to 0 to build for a POSIX host, where <coremark_main> takes argc/argv
+	and parallel contexts are run with pthreads.
+*/
+#ifndef COREMARK_ARDUINO
+#define COREMARK_ARDUINO 1
+#endif
+#if (COREMARK_ARDUINO==1)
 #include "application.h"
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 //--------------------------------------------------------------//
 
 //---------------------------------------------core_portme.h--------------------------------------------------//
@@ -67,14 +83,22 @@ El Dorado Hills, CA, 95762
 	Define type of return from the timing functions.
  */
 #include <time.h>
+#if (COREMARK_ARDUINO==1)
 typedef clock_t CORE_TICKS;
+#else
+typedef unsigned long long CORE_TICKS;
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+#endif
 
 /* Definitions : COMPILER_VERSION, COMPILER_FLAGS, MEM_LOCATION
 	Initialize these strings per platform
 */
 #ifndef COMPILER_VERSION 
  #ifdef __GNUC__
- #define COMPILER_VERSION "GCC"__VERSION__
+ #define COMPILER_VERSION "GCC" __VERSION__
  #else
  #define COMPILER_VERSION "Please put compiler version here (e.g. gcc 4.1)"
  #endif
@@ -83,7 +107,11 @@ typedef clock_t CORE_TICKS;
  #define COMPILER_FLAGS "" // MZI FLAGS_STR /* "Please put compiler flags here (e.g. -o3)" */
 #endif
 #ifndef MEM_LOCATION 
+ #if (COREMARK_ARDUINO==1)
  #define MEM_LOCATION "STACK"
+ #else
+ #define MEM_LOCATION "HEAP"
+ #endif
 #endif
 
 /* Data Types :
@@ -98,7 +126,11 @@ typedef signed int ee_s32;
 typedef double ee_f32;
 typedef unsigned char ee_u8;
 typedef unsigned int ee_u32;
+#if (COREMARK_ARDUINO==1)
 typedef ee_u32 ee_ptr_int;
+#else
+typedef unsigned long ee_ptr_int;
+#endif
 typedef size_t ee_size_t;
 /* align_mem :
 	This macro is used to align an offset to point to a 32b value. It is used in the Matrix algorithm to initialize the input memory blocks.
@@ -112,9 +144,14 @@ typedef size_t ee_size_t;
 	SEED_ARG - from command line.
 	SEED_FUNC - from a system function.
 	SEED_VOLATILE - from volatile variables.
+	Hosts default to SEED_ARG, see <coremark_main> for the arguments, the Spark to SEED_VOLATILE.
 */
 #ifndef SEED_METHOD
+#if (COREMARK_ARDUINO==1)
 #define SEED_METHOD SEED_VOLATILE
+#else
+#define SEED_METHOD SEED_ARG
+#endif
 #endif
 
 /* Configuration : MEM_METHOD
@@ -126,7 +163,11 @@ typedef size_t ee_size_t;
 	MEM_STACK - to allocate the data block on the stack (NYI).
 */
 #ifndef MEM_METHOD
+#if (COREMARK_ARDUINO==1)
 #define MEM_METHOD MEM_STACK
+#else
+#define MEM_METHOD MEM_MALLOC
+#endif
 #endif
 
 /* Configuration : MULTITHREAD
@@ -143,13 +184,36 @@ typedef size_t ee_size_t;
 	
 	It is valid to have a different implementation of <core_start_parallel> and <core_end_parallel> in <core_portme.c>,
 	to fit a particular architecture. 
+
+	With <USE_PTHREAD>, MULTITHREAD is only an upper bound. The actual number of contexts is 
+	chosen at run time by <portable_init> (-threads=N, 0 for one per online core), 
+	and each context gets its own <core_results> and memory block.
 */
+#ifndef USE_PTHREAD
+#if (COREMARK_ARDUINO==1)
+#define USE_PTHREAD 0
+#else
+#define USE_PTHREAD 1
+#endif
+#endif
 #ifndef MULTITHREAD
+#if USE_PTHREAD
+#define MULTITHREAD 1024
+#else
 #define MULTITHREAD 1
-#define USE_PTHREAD 0
+#endif
+#endif
+#ifndef USE_FORK
 #define USE_FORK 0
+#endif
+#ifndef USE_SOCKET
 #define USE_SOCKET 0
 #endif
+#if USE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#define PARALLEL_METHOD "PThreads"
+#endif
 
 /* Configuration : MAIN_HAS_NOARGC
 	Needed if platform does not support getting arguments to main. 
@@ -176,13 +240,170 @@ typedef size_t ee_size_t;
 #define MAIN_HAS_NORETURN 0
 #endif
 
+/* Configuration : KERNEL_PROFILE
+	Define to 1 to accumulate time and call counts per kernel (list find/reverse/sort, state, matrix
+	and the steps of <matrix_test>) and report each kernel's share of the run.
+
+	Every probe is a pair of reads of the selected <core_timer>, use -timer=tsc on x86 for the lowest overhead.
+	The estimated probe overhead is reported along with the results.
+*/
+#ifndef KERNEL_PROFILE
+#define KERNEL_PROFILE 0
+#endif
+
+/* Configuration : LATENCY_HIST
+	Define to 1 to support a per iteration latency histogram, enabled at run time with -latency=1.
+
+	Every iteration of <iterate> is timestamped with the selected <core_timer> and recorded in a
+	log-linear histogram of <LAT_SUB> buckets per power of two held in <core_results>, so nothing is allocated while running.
+	p50/p90/p99/p99.9/max are reported per context along with the recording overhead.
+	The histogram takes about 8KB per context, so it is off by default on the Spark.
+*/
+#ifndef LATENCY_HIST
+#if (COREMARK_ARDUINO==0)
+#define LATENCY_HIST 1
+#else
+#define LATENCY_HIST 0
+#endif
+#endif
+/* Configuration : MATRIX_SIMD
+	Define to 1 to build SIMD variants of the element wise matrix kernels of <matrix_test>:
+	SSE2, AVX2 and AVX-512 on x86-64, NEON on AArch64. The variant is chosen at run time with -simd=,
+	where auto picks the widest one the cpu supports, see <core_matrix_kernels>. Every variant gives
+	bit identical results, the default stays scalar so that scores remain comparable.
+	Needs GCC or clang for the target attributes, on by default on such hosts.
+*/
+#ifndef MATRIX_SIMD
+#if (COREMARK_ARDUINO==0) && defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+#define MATRIX_SIMD 1
+#else
+#define MATRIX_SIMD 0
+#endif
+#endif
+#if MATRIX_SIMD && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+#if USE_PTHREAD
+#define CORE_THREAD_LOCAL __thread
+#else
+#define CORE_THREAD_LOCAL
+#endif
+
 /* Variable : default_num_contexts
-	Not used for this simple port, must cintain the value 1.
+	Number of contexts to run. Must contain the value 1 unless <USE_PTHREAD> is enabled,
+	in which case <portable_init> sets it at run time.
 */
 extern ee_u32 default_num_contexts;
 
+/* Configuration : SCHED_STATIC, SCHED_STEAL
+	How iterations are scheduled across parallel contexts, selected at run time with -sched=.
+
+	SCHED_STATIC - every context runs a fixed <core_results.iterations> (default).
+	SCHED_STEAL - the total budget is split into chunks queued on per context deques,
+	and idle contexts steal chunks from busy ones, so a slow or preempted core does not
+	stretch the wall clock. Every context still runs at least one iteration to produce its own crcs.
+*/
+#define SCHED_STATIC 0
+#define SCHED_STEAL 1
+
+/* Configuration : FORMAT_TEXT, FORMAT_JSON, FORMAT_CSV
+	Report format, selected at run time with -format=.
+
+	FORMAT_TEXT - the human readable report (default).
+	FORMAT_JSON - a single line JSON object per run, for JSON lines collectors.
+	FORMAT_CSV - a header line and a data line per run.
+	The machine readable formats carry the size, seeds, iterations, ticks, time, per context crcs,
+	validation status, compiler, memory location, thread count, timer and cpu model.
+*/
+#define FORMAT_TEXT 0
+#define FORMAT_JSON 1
+#define FORMAT_CSV 2
+
+/* Configuration : MEMBLOCK_MALLOC, MEMBLOCK_LINE, MEMBLOCK_PAGE, MEMBLOCK_THP, MEMBLOCK_HUGETLB
+	Backend of <portable_memblock_alloc> for the data blocks when <MEM_METHOD> is MEM_MALLOC,
+	selected at run time with -mem=.
+
+	MEMBLOCK_MALLOC - plain malloc.
+	MEMBLOCK_LINE - aligned to a cache line (<MEMBLOCK_LINE_SIZE>) and padded to whole lines (default),
+	so that no two contexts share a line.
+	MEMBLOCK_PAGE - aligned to a page.
+	MEMBLOCK_THP - aligned to a huge page and advised for transparent huge pages with madvise.
+	MEMBLOCK_HUGETLB - mmap with MAP_HUGETLB from the reserved huge page pool.
+	When a backend is not available it falls back to the next simpler one, the backend actually used is reported.
+*/
+#define MEMBLOCK_MALLOC 0
+#define MEMBLOCK_LINE 1
+#define MEMBLOCK_PAGE 2
+#define MEMBLOCK_THP 3
+#define MEMBLOCK_HUGETLB 4
+#define NUM_MEMBLOCK_METHODS 5
+#ifndef MEMBLOCK_LINE_SIZE
+#define MEMBLOCK_LINE_SIZE 64
+#endif
+
+/* Configuration : SOAK_FOREVER
+	Soak mode keeps running the initialized contexts after the benchmark and reports iterations/sec
+	for every window of <core_options.soak_window> ms, along with the trend and a warning when the
+	sustained throughput drops more than <core_options.soak_throttle> percent below the first window
+	(thermal or power throttling).
+
+	<core_options.soak> is the duration in seconds, 0 for no soak (default), or SOAK_FOREVER to run
+	until <portable_soak_stop> says so: Ctrl-C on a host, any serial input on the Spark.
+*/
+#define SOAK_FOREVER 0xffffffff
+
+/* Configuration : MAX_SCALE_POINTS
+	Maximum number of context counts in a scaling curve, selected at run time with -scale=.
+	After the benchmark, the contexts are run again with each count and the aggregate and per context
+	iterations/sec and the parallel efficiency relative to one context are reported.
+*/
+#define MAX_SCALE_POINTS 32
+
+/* Variable : portable_options
+	Run time options of the port, set by <portable_init>.
+*/
+typedef struct CORE_OPTIONS_S {
+	ee_u8	sched;	/* SCHED_STATIC or SCHED_STEAL */
+	ee_u32	chunk;	/* iterations per chunk with SCHED_STEAL, 0 for automatic */
+	ee_u8	perf;	/* collect hardware counters, see <HAS_PERF_EVENTS> */
+	ee_u32	warmup;	/* discarded trials */
+	ee_u32	trials;	/* measured trials */
+	ee_u8	format;	/* FORMAT_TEXT, FORMAT_JSON or FORMAT_CSV */
+	ee_u8	latency;	/* record per iteration latencies, see <LATENCY_HIST> */
+	ee_u32	soak;		/* soak duration in seconds, see <SOAK_FOREVER> */
+	ee_u32	soak_window;	/* soak window in ms */
+	ee_u32	soak_throttle;	/* throttling warning threshold in percent below the first window */
+	const char *refcache;	/* file caching reference crcs, NULL for $COREMARK_REF_CACHE, see <portable_ref_load> */
+	const char *snapshot;	/* directory of initialized data snapshots, NULL for none, see <portable_snapshot_load> */
+	ee_u32	sweep_min;	/* smallest data size per algorithm of a size sweep, 0 for no sweep */
+	ee_u32	sweep_max;	/* largest data size per algorithm of a size sweep */
+	ee_u8	mem;		/* requested backend of <portable_memblock_alloc> */
+	ee_u8	numa;		/* memory placement, see <NUMA_LOCAL> */
+	ee_u8	affinity;	/* cpu placement of the contexts, see <AFFINITY_COMPACT> */
+	ee_u8	percpu;		/* score one context pinned to every cpu in turn, see <portable_cpu_class> */
+	ee_u8	falseshare;	/* run the false sharing probe, see <false_sharing_probe> */
+	ee_u8	matcompare;	/* compare the naive and blocked matrix multiply, see <matrix_compare> */
+	ee_u32	scale_points;	/* number of context counts in scale, 0 for no scaling curve */
+	ee_u32	scale[MAX_SCALE_POINTS];	/* context counts of the scaling curve */
+} core_options;
+extern core_options portable_options;
+void portable_soak_begin(void);
+ee_u8 portable_soak_stop(void);
+void portable_soak_end(void);
+
 typedef struct CORE_PORTABLE_S {
 	ee_u8	portable_id;
+#if USE_PTHREAD
+	pthread_t thread;
+	ee_u32	ctx;		/* index of the context */
+	pthread_mutex_t lock;	/* protects the chunk deque below */
+	ee_u32	*deque;		/* chunk sizes, the owner pops at bottom, thieves take from top */
+	ee_u32	top;
+	ee_u32	bottom;
+	ee_u32	steals;		/* number of chunks stolen by this context */
+	ee_s32	cpu;		/* cpu the context is pinned to, -1 if not pinned */
+	ee_s32	node;		/* NUMA node the memory is bound to, -1 if not bound */
+#endif
 } core_portable;
 
 /* target specific init/fini */
@@ -220,16 +441,31 @@ void portable_fini(core_portable *p);
 #if HAS_PRINTF
 #define ee_printf printf
 #endif
+/* Function : ee_errorf
+	Print a diagnostic. On a host it goes to stderr, so that json and csv output on stdout stays parseable.
+*/
+#if HAS_STDIO && (COREMARK_ARDUINO==0)
+#define ee_errorf(...) fprintf(stderr,__VA_ARGS__)
+#else
+#define ee_errorf ee_printf
+#endif
 
 //----------------------------LT--------------------------------//
 //#define ITERATIONS 5000
 //#include "Arduino.h"
 //----------------------------LT--------------------------------//
-#define COREMARK_ARDUINO 1
+/* Configuration : ITERATIONS
+	Iterations of a <SEED_VOLATILE> build, 0 to determine them so that the benchmark runs at least 10 secs.
+	<SEED_ARG> builds take the iterations from the command line instead.
+*/
+#ifndef ITERATIONS
 #define ITERATIONS 50
+#endif
 
 #if (COREMARK_ARDUINO==1)
 int coremark_main(void);
+#else
+int coremark_main(int argc, char *argv[]);
 #endif
 //--------------------------------------------------------------//
 
@@ -241,6 +477,7 @@ void *iterate(void *pres);
 	Otherwise an unsigned int.
 */
 #if HAS_FLOAT
+#include <math.h>
 typedef double secs_ret;
 #else
 typedef ee_u32 secs_ret;
@@ -259,6 +496,126 @@ void stop_time(void);
 CORE_TICKS get_time(void);
 secs_ret time_in_secs(CORE_TICKS ticks);
 
+/* Structure : core_timer
+	Timer backend behind <start_time>, <stop_time>, <get_time> and <time_in_secs>.
+
+	<now> reads a free running tick counter, <init> (if any) calibrates <ticks_per_sec>.
+	Backends are selected at run time with <portable_timer_select>.
+*/
+typedef struct CORE_TIMER_S {
+	const char *name;
+	CORE_TICKS (*now)(void);
+	void (*init)(struct CORE_TIMER_S *t);
+	CORE_TICKS ticks_per_sec;
+} core_timer;
+extern core_timer *portable_timer;
+core_timer *portable_timer_select(const char *name);
+void portable_cpu_model(char *buf, ee_u32 len);
+
+/* Structure : core_cache
+	Data (or unified) cache size per level in bytes, level 1 at index 0, as reported by <portable_cache_info>.
+*/
+#define MAX_CACHE_LEVELS 4
+typedef struct CORE_CACHE_S {
+	ee_u32 levels;
+	ee_u32 size[MAX_CACHE_LEVELS];
+} core_cache;
+void portable_cache_info(core_cache *c);
+
+/* Configuration : HAS_PERF_EVENTS
+	Define to 1 if the platform has the Linux perf_event_open system call.
+	Hardware counters are then collected at run time with -perf=1.
+*/
+#ifndef HAS_PERF_EVENTS
+#if (COREMARK_ARDUINO==0) && defined(__linux__)
+#define HAS_PERF_EVENTS 1
+#else
+#define HAS_PERF_EVENTS 0
+#endif
+#endif
+#if HAS_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <errno.h>
+
+/* Structure : core_perf
+	Hardware counters around a measured region. Counters that cannot be opened have fd -1.
+*/
+typedef enum CORE_PERF_COUNTER {
+	PERF_CYCLES=0,
+	PERF_INSTRUCTIONS,
+	PERF_BRANCH_MISSES,
+	PERF_L1D_MISSES,
+	PERF_LLC_MISSES,
+	PERF_DTLB_MISSES,
+	NUM_PERF_COUNTERS
+} core_perf_e;
+typedef struct CORE_PERF_S {
+	int fd[NUM_PERF_COUNTERS];
+	unsigned long long value[NUM_PERF_COUNTERS];
+} core_perf;
+ee_u8 portable_perf_open(core_perf *p);
+void portable_perf_start(core_perf *p);
+void portable_perf_stop(core_perf *p);
+void portable_perf_close(core_perf *p);
+void portable_perf_report(core_perf *p, const char *label, ee_u32 iterations);
+#endif
+
+/* Configuration : HAS_NUMA
+	Define to 1 if the platform has the Linux mbind system call and sched_setaffinity.
+	Contexts can then be pinned to cpus with their memory bound to a NUMA node at run time with -numa=,
+	see <NUMA_LOCAL>. The raw system call is used, so libnuma is not needed.
+*/
+#ifndef HAS_NUMA
+#if USE_PTHREAD && defined(__linux__)
+#define HAS_NUMA 1
+#else
+#define HAS_NUMA 0
+#endif
+#endif
+/* Configuration : NUMA_OFF, NUMA_LOCAL, NUMA_REMOTE, NUMA_BOTH
+	Memory placement of the contexts, selected at run time with -numa=.
+
+	NUMA_OFF - no pinning, memory is wherever the allocator puts it (default).
+	NUMA_LOCAL - context i is pinned to the i-th allowed cpu and its memory bound to that cpu's node.
+	NUMA_REMOTE - as NUMA_LOCAL, with the memory bound to the next node instead.
+	NUMA_BOTH - the benchmark runs local, then the memory is migrated to the remote node and the
+	run is repeated, so local and remote scores are reported side by side.
+*/
+#define NUMA_OFF 0
+#define NUMA_LOCAL 1
+#define NUMA_REMOTE 2
+#define NUMA_BOTH 3
+/* Configuration : AFFINITY_NONE, AFFINITY_COMPACT, AFFINITY_SCATTER, AFFINITY_SMT_PAIRS, AFFINITY_ALL
+	Placement of the contexts on cpus, selected at run time with -affinity=.
+	The order of the cpus comes from the topology in sysfs (package, core and SMT siblings),
+	see <portable_affinity_order>.
+
+	AFFINITY_NONE - contexts are not pinned (default).
+	AFFINITY_COMPACT - fill all SMT siblings of a core before moving to the next core.
+	AFFINITY_SCATTER - one context per physical core first, spread over packages, then the next siblings.
+	AFFINITY_SMT_PAIRS - contexts 2k and 2k+1 on two siblings of the same core, cores without siblings are left out.
+	AFFINITY_ALL - run the benchmark with the contexts unpinned, then once more under every policy, and report the scores side by side.
+*/
+#define AFFINITY_NONE 0
+#define AFFINITY_COMPACT 1
+#define AFFINITY_SCATTER 2
+#define AFFINITY_SMT_PAIRS 3
+#define AFFINITY_ALL 4
+#define NUM_AFFINITY_POLICIES 4
+#if HAS_NUMA
+#include <sched.h>
+#include <sys/syscall.h>
+extern const char *affinity_names[NUM_AFFINITY_POLICIES+1];
+ee_u32 portable_affinity_order(ee_u8 policy, ee_s32 *cpus, ee_u32 max);
+ee_s32 portable_cpu_allowed(ee_u32 n);
+ee_u32 portable_cpu_class(ee_u32 cpu, const char **source);
+ee_s32 portable_cpu_node(ee_u32 cpu);
+ee_u32 portable_numa_nodes(void);
+ee_u8 portable_mem_bind(void *p, ee_size_t size, ee_u32 node, ee_u8 move);
+#endif
+
 /* Misc useful functions */
 ee_u16 crcu8(ee_u8 data, ee_u16 crc);
 ee_u16 crc16(ee_s16 newval, ee_u16 crc);
@@ -267,6 +624,12 @@ ee_u16 crcu32(ee_u32 newval, ee_u16 crc);
 ee_u8 check_data_types();
 void *portable_malloc(ee_size_t size);
 void portable_free(void *p);
+void *portable_memblock_alloc(ee_size_t size);
+void *portable_memblock_alloc_with(ee_u8 method, ee_size_t size);
+ee_size_t portable_memblock_len(void *p);
+void portable_memblock_free(void *p);
+extern ee_u8 portable_memblock_used;
+extern const char *memblock_names[NUM_MEMBLOCK_METHODS];
 ee_s32 parseval(char *valstring);
 
 /* Algorithm IDS */
@@ -303,8 +666,33 @@ typedef struct MAT_PARAMS_S {
 	MATDAT *A;
 	MATDAT *B;
 	MATRES *C;
+	MATDAT *Bt;	/* transposed copy of B, NULL unless <matrix_transposed> */
 } mat_params;
 
+/* Structure : core_matrix_kernels
+	One implementation of the element wise kernels of <matrix_test>, see <MATRIX_SIMD>.
+	<supported> (if any) checks at run time that the cpu can run it.
+	Variants are selected with <matrix_kernels_select>.
+*/
+typedef struct CORE_MATRIX_KERNELS_S {
+	const char *name;
+	ee_u8 (*supported)(void);
+	void (*add_const)(ee_u32 N, MATDAT *A, MATDAT val);
+	void (*mul_const)(ee_u32 N, MATRES *C, MATDAT *A, MATDAT val);
+	void (*mul_vect)(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B);
+	void (*mul_matrix)(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B);
+	void (*mul_matrix_bitextract)(ee_u32 N, MATRES *C, MATDAT *A, MATDAT *B);
+} core_matrix_kernels;
+extern const core_matrix_kernels *matrix_kernels;
+const core_matrix_kernels *matrix_kernels_select(const char *name);
+const char *matrix_mul_kernels_name(void);
+extern ee_u32 matrix_tile;
+extern ee_u32 matrix_tile_rows;
+void matrix_blocking_init(void);
+extern ee_u8 matrix_transposed;
+ee_u32 matrix_transposed_space(ee_u32 blksize);
+extern ee_u8 matrix_fused;
+
 /* state machine related stuff */
 /* List of all the possible states for the FSM */
 typedef enum CORE_STATE {
@@ -319,8 +707,67 @@ typedef enum CORE_STATE {
 	NUM_CORE_STATES
 } core_state_e ;
 
+
+/* kernel profiling related stuff */
+typedef enum CORE_KERNEL {
+	KERNEL_ITERATE=0,
+	KERNEL_LIST_FIND,
+	KERNEL_LIST_REVERSE,
+	KERNEL_LIST_SORT,
+	KERNEL_STATE,
+	KERNEL_MATRIX,
+	KERNEL_MATRIX_ADD_CONST,
+	KERNEL_MATRIX_MUL_CONST,
+	KERNEL_MATRIX_MUL_VECT,
+	KERNEL_MATRIX_MUL_MATRIX,
+	KERNEL_MATRIX_BITEXTRACT,
+	KERNEL_MATRIX_SUM,
+	NUM_KERNELS
+} core_kernel_e;
+
+typedef struct KPROF_S {
+	CORE_TICKS ticks[NUM_KERNELS];
+	ee_u32 calls[NUM_KERNELS];
+} core_kprof;
+
+#if KERNEL_PROFILE
+extern CORE_THREAD_LOCAL core_kprof *kprof_cur;
+#define KPROF_DECL(t) CORE_TICKS t
+#define KPROF_START(t) t=portable_timer->now()
+#define KPROF_STOP(t,id) kprof_add((id),(t))
+#else
+#define KPROF_DECL(t)
+#define KPROF_START(t)
+#define KPROF_STOP(t,id)
+#endif
+
+#if LATENCY_HIST
+/* Structure : core_latency
+	Log-linear latency histogram. Values below <LAT_SUB> ticks have a bucket each, above that every
+	power of two is split in <LAT_SUB> buckets, so any value is recorded within 1/<LAT_SUB> of its size.
+*/
+#define LAT_SUB_BITS 5
+#define LAT_SUB (1<<LAT_SUB_BITS)
+#define LAT_BUCKETS ((65-LAT_SUB_BITS)*LAT_SUB)
+typedef struct LATENCY_S {
+	ee_u32 count[LAT_BUCKETS];
+	ee_u32 total;
+	CORE_TICKS max;
+} core_latency;
+#endif
 		
 /* Helper structure to hold results */
+/* Structure : core_crcs
+	Running crcs written while iterating. <iterate> keeps them on its own stack, <false_sharing_probe>
+	packs those of all contexts into one array so that they share cache lines.
+*/
+typedef struct CORE_CRCS_S {
+	ee_u16	crc;
+	ee_u16	crclist;
+	ee_u16	crcmatrix;
+	ee_u16	crcstate;
+} core_crcs;
+
 typedef struct RESULTS_S {
 	/* inputs */
 	ee_s16	seed1;		/* Initializing seed */
@@ -339,15 +786,83 @@ typedef struct RESULTS_S {
 	ee_u16	crcmatrix;
 	ee_u16	crcstate;
 	ee_s16	err;
+	ee_u8	snapshot;	/* data restored from a snapshot */
+	core_crcs *run;		/* running crcs while iterating, NULL to keep them on the stack of <iterate> */
+#if KERNEL_PROFILE
+	core_kprof kprof;
+#endif
+#if LATENCY_HIST
+	core_latency lat;
+#endif
 	/* ultithread specific */
 	core_portable port;
 } core_results;
 
+/* Structure : core_ref
+	Expected crcs for a seed triple, per algorithm data size and set of algorithms,
+	computed by <reference_crcs> for runs whose parameters are not in the known tables.
+*/
+typedef struct CORE_REF_S {
+	ee_s16	seed1;
+	ee_s16	seed2;
+	ee_s16	seed3;
+	ee_u32	size;
+	ee_u32	execs;
+	ee_u16	crclist;
+	ee_u16	crcmatrix;
+	ee_u16	crcstate;
+} core_ref;
+ee_u8 portable_ref_load(core_ref *ref);
+void portable_ref_store(core_ref *ref);
+
+/* Structure : core_snapshot
+	Header of a snapshot of the initialized data of a context. The key fields select the file,
+	the pointers are those of the context that was saved, to rebase the data in a new block.
+*/
+#define SNAPSHOT_MAGIC 0x534d4b43
+#define SNAPSHOT_VERSION 1
+typedef struct CORE_SNAPSHOT_S {
+	ee_u32	magic;
+	ee_u32	ptrsize;
+	ee_u32	version;
+	ee_s16	seed1;
+	ee_s16	seed2;
+	ee_u32	size;
+	ee_u32	execs;
+	ee_u32	layout;		/* <matrix_transposed> */
+	ee_u32	len;		/* bytes of data following the header */
+	ee_u8	*base;		/* memblock[0] of the saved context */
+	struct list_head_s *list;
+	mat_params mat;
+} core_snapshot;
+ee_u8 portable_snapshot_load(core_snapshot *snap, void *data);
+void portable_snapshot_store(core_snapshot *snap, void *data);
+
+#if KERNEL_PROFILE
+void kprof_begin(core_results *res);
+void kprof_add(core_kernel_e id, CORE_TICKS start);
+void kprof_end(core_results *res, CORE_TICKS start);
+void kprof_report(core_results **res, ee_u32 num);
+#endif
+#if LATENCY_HIST
+void latency_begin(core_latency *h);
+void latency_record(core_latency *h, CORE_TICKS v);
+CORE_TICKS latency_percentile(core_latency *h, double q);
+void latency_report(core_results **res, ee_u32 num);
+#endif
+
 /* Multicore execution handling */
 #if (MULTITHREAD>1)
 ee_u8 core_start_parallel(core_results *res);
 ee_u8 core_stop_parallel(core_results *res);
 #endif
+#if USE_PTHREAD
+void *iterate_steal(void *pres);
+ee_u8 portable_thread_start(core_results *res, void *(*fn)(void *));
+void portable_sched_init(core_results **res, ee_u32 num, ee_u32 iterations);
+ee_u32 portable_sched_next(core_results *res);
+void portable_sched_fini(core_results **res, ee_u32 num);
+#endif
 
 /* list benchmark functions */
 //list_head *core_list_init(ee_u32 blksize, list_head *memblock, ee_s16 seed);
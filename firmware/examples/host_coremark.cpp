@@ -0,0 +1,17 @@
+/* Host entry point for running coremark on a POSIX machine.
+
+	Build with:
+	g++ -O2 -DCOREMARK_ARDUINO=0 -Ifirmware firmware/coremark.cpp firmware/examples/host_coremark.cpp -lpthread
+
+	Run with:
+	./a.out [-name=value...] [seed1 seed2 seed3 [iterations [execs [unused [size]]]]]
+
+	e.g. ./a.out -threads=4 -format=json 0x3415 0x3415 0x66 0 7 0 64K runs the validation seeds
+	in 4 contexts (-threads=0 for one per online core) with 64KB of data each, iterations determined
+	automatically, and reports in JSON. Without seeds the performance seeds 0 0 0x66 are used.
+*/
+#include "coremark.h"
+
+int main(int argc, char *argv[]) {
+	return coremark_main(argc, argv);
+}
@@ -4,15 +4,24 @@
 void setup() {
   // put your setup code here, to run once:
   Serial.begin(9600);         // Open serial over USB.
-  while(!Serial.available())  // Wait here until the user presses ENTER 
+  while(!Serial.available())  // Wait here until the user presses ENTER
     SPARK_WLAN_Loop();        // in the Serial Terminal. Call the BG Tasks
                               // while we are hanging around doing nothing.
+  // After the benchmark keep running in soak mode until ENTER is pressed again,
+  // reporting iterations/sec every second and warning when throughput drops
+  // more than 10% below the first second (thermal or power throttling).
+  portable_options.soak = SOAK_FOREVER;
+  portable_options.soak_window = 1000;
+  portable_options.soak_throttle = 10;
 }
 
 void loop() {
   // put your main code here, to run repeatedly:
   int total_time = 0;
   total_time = coremark_main();
-  Serial.println("Coremark Running");
-
+  Serial.println("Coremark soak stopped, press ENTER to run again");
+  while(Serial.available())   // Drop the key that stopped the soak
+    Serial.read();
+  while(!Serial.available())
+    SPARK_WLAN_Loop();
 }